@@ -0,0 +1,114 @@
+/**
+ * @file Team BLRS Buttons Library
+ *       > Joystick Axes
+ * @brief Reads the analog axes of both joysticks and applies a deadzone, an expo curve and slew to each
+ *
+ * The deadzone and curve of an axis are combined into a 256 entry table when they are configured, so each poll only
+ * needs one table lookup per axis and no floating point. Axes are polled with axisPoll, which the button poller
+ * (buttonPollerStart) also calls, and every axis can be read from the same poll with axisGetSnapshot.
+ *
+ * Example code:
+ * @code
+ *		axisSetCurve(JOY1_CH3, 10, 0.5);
+ *		axisSetCurve(JOY1_CH4, 10, 0.7);
+ *		buttonPollerStart(20);
+ *		...
+ *		chassisArcade(axisGet(JOY1_CH3), axisGet(JOY1_CH4));
+ * @endcode
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXES_H_
+#define AXES_H_
+
+#include <API.h>
+
+/**
+ * The analog axes of the joysticks
+ */
+typedef enum {
+	JOY1_CH1 = 0,
+	JOY1_CH2 = 1,
+	JOY1_CH3 = 2,
+	JOY1_CH4 = 3,
+
+	JOY2_CH1 = 4,
+	JOY2_CH2 = 5,
+	JOY2_CH3 = 6,
+	JOY2_CH4 = 7
+} axis_t;
+
+#define AXIS_COUNT 8
+
+/**
+ * @brief Sets the deadzone and curve of an axis. Until set, an axis passes the joystick value through unchanged.
+ *
+ * @param axis
+ *        The axis to configure
+ *
+ * @param deadzone
+ *        Joystick values of at most this magnitude read as 0. Values above it are rescaled to start from 0, so
+ *        there is no jump at the edge of the deadzone.
+ *
+ * @param expo
+ *        [0,1] mix of a cubic curve with the linear one: 0 is linear, 1 is fully cubic. Higher values give finer
+ *        control near the center while keeping full output at the ends.
+ */
+void axisSetCurve(axis_t axis, int deadzone, float expo);
+
+/**
+ * @brief Limits how fast the value of an axis can change
+ *
+ * @param axis
+ *        The axis to configure
+ *
+ * @param slew
+ *        Most change per millisecond, or 0 for no limit (the default)
+ */
+void axisSetSlew(axis_t axis, float slew);
+
+/**
+ * @brief Reads every axis of both joysticks once and updates their values. The button poller polls the axes too, so
+ *        this only needs to be called when the poller is not running.
+ */
+void axisPoll();
+
+/**
+ * @brief Reads every axis of both joysticks once, without updating their values
+ *
+ * @param raw
+ *        Receives AXIS_COUNT joystick values, in the order of axis_t
+ */
+void axisRead(signed char* raw);
+
+/**
+ * @brief Updates the values of the axes like axisPoll, from joystick values read elsewhere (e.g. by axisRead or a
+ *        replay)
+ *
+ * @param raw
+ *        AXIS_COUNT joystick values, in the order of axis_t
+ */
+void axisUpdate(const signed char* raw);
+
+/**
+ * @return The value of an axis [-127,127] after its deadzone, curve and slew, as of the latest poll
+ */
+int axisGet(axis_t axis);
+
+/**
+ * @return The joystick value of an axis as of the latest poll
+ */
+int axisGetRaw(axis_t axis);
+
+/**
+ * @brief Copies the values of every axis from the same poll
+ *
+ * @param values
+ *        Receives AXIS_COUNT values, in the order of axis_t
+ */
+void axisGetSnapshot(signed char* values);
+
+#endif
@@ -49,6 +49,49 @@ typedef enum {
 	LCD_RIGHT = 26
 } button_t;
 
+#define BUTTON_COUNT 27
+
+/**
+ * The bit of a button in the button masks (see buttonPoll)
+ */
+#define BUTTON_MASK(button) (1U << (button))
+
+/**
+ * Kinds of button events, see buttonOnEvent
+ */
+typedef enum {
+	BUTTON_PRESS = 0,      // the button went down
+	BUTTON_RELEASE = 1,    // the button went up
+	BUTTON_HOLD = 2,       // the button has been down for its hold time (once per press)
+	BUTTON_DOUBLE_TAP = 3, // the button went down a second time within its double tap time
+	BUTTON_CHORD = 4       // every button of a chord is down, see buttonChordAdd
+} buttonevent_type_t;
+
+#define BUTTON_EVENT_TYPES 4     // event types that belong to a single button (all but BUTTON_CHORD)
+#define BUTTON_HOLD_TIME 500     // default hold time in milliseconds
+#define BUTTON_DOUBLE_TAP_TIME 300 // default double tap time in milliseconds
+#define BUTTON_QUEUE_SIZE 32     // events kept for buttonEventGet
+#define BUTTON_MAX_CHORDS 8
+
+/**
+ * A button event
+ */
+typedef struct {
+	unsigned long time;  // millis() of the buttonPoll that detected it
+	unsigned char button; // the button_t, or the chord index for BUTTON_CHORD
+	unsigned char type;  // the buttonevent_type_t
+} buttonevent_t;
+
+typedef void (*buttonhandler_t)(buttonevent_t event);
+
+/**
+ * Remembers which presses and releases a consumer (e.g. a task) has already seen, see buttonCursorInit
+ */
+typedef struct {
+	unsigned int presses[BUTTON_COUNT];
+	unsigned int releases[BUTTON_COUNT];
+} buttoncursor_t;
+
 /**
  * @brief Initializes the buttons
  */
@@ -62,6 +105,9 @@ void buttonInit();
 *        The button to detect from the Buttons enumeration (see include/buttons.h).
 *
 * @return true or false depending on if there was a change in button state.
+*
+* @note A press is only reported to the first caller that sees it. Tasks sharing a button should use
+*       buttonCursorIsNewPress instead.
  */
 bool buttonIsNewPress(button_t);
 
@@ -75,4 +121,187 @@ bool buttonIsNewPress(button_t);
  */
 bool buttonGetState(button_t);
 
+/**
+ * @brief Reads every joystick and LCD button once into a snapshot, and finds the buttons that were pressed and
+ *        released since the previous snapshot. The buttonIs functions then only test bits of the snapshot.
+ *
+ * Example code:
+ * @code
+ *		while (true) {
+ *			buttonPoll();
+ *			if (buttonIsPressed(JOY1_8D))
+ *				digitalWrite(1, !digitalRead(1));
+ *			if (buttonIsDown(JOY1_6U))
+ *				...
+ *			delay(20);
+ *		}
+ * @endcode
+ *
+ * @return The buttons that are down, with the bit BUTTON_MASK(button) set for each
+ */
+unsigned int buttonPoll();
+
+/**
+ * @brief Reads every joystick and LCD button once, without updating the snapshot
+ *
+ * @return The buttons that are down, as BUTTON_MASK bits
+ */
+unsigned int buttonRead();
+
+/**
+ * @brief Updates the snapshot like buttonPoll, from buttons read elsewhere (e.g. by buttonRead or a replay)
+ *
+ * @param state
+ *        The buttons that are down, as BUTTON_MASK bits
+ *
+ * @return state
+ */
+unsigned int buttonUpdate(unsigned int state);
+
+/**
+ * @return true if the button was down in the latest snapshot
+ */
+bool buttonIsDown(button_t button);
+
+/**
+ * @return true if the button went down between the previous snapshot and the latest one
+ */
+bool buttonIsPressed(button_t button);
+
+/**
+ * @return true if the button went up between the previous snapshot and the latest one
+ */
+bool buttonIsReleased(button_t button);
+
+/**
+ * @return The buttons that went down between the previous snapshot and the latest one, as BUTTON_MASK bits
+ */
+unsigned int buttonGetPressedMask();
+
+/**
+ * @return The buttons that went up between the previous snapshot and the latest one, as BUTTON_MASK bits
+ */
+unsigned int buttonGetReleasedMask();
+
+/**
+ * @brief Starts a task that polls the buttons and axes (see axes.h) every period milliseconds, through inputPoll
+ *        so that they can be recorded and replayed (see replay.h). While it runs, no other task should poll them;
+ *        tasks use buttonCursor functions to see each press and release exactly once, independently of
+ *        each other and without locks.
+ *
+ * @param period
+ *        Time between polls in milliseconds
+ *
+ * @return The poller task, or NULL if it could not be started or is already running
+ */
+TaskHandle buttonPollerStart(unsigned long period);
+
+/**
+ * @brief Stops the task started by buttonPollerStart
+ */
+void buttonPollerStop();
+
+/**
+ * @return The number of times a button has been pressed (seen going down by buttonPoll), wrapping around
+ */
+unsigned int buttonGetPressCount(button_t button);
+
+/**
+ * @brief Starts a consumer of button events from the current state: presses and releases that have already
+ *        happened are not reported.
+ *
+ * Example code, in each task that reacts to buttons:
+ * @code
+ *		buttoncursor_t cursor;
+ *		buttonCursorInit(&cursor);
+ *		while (true) {
+ *			if (buttonCursorIsNewPress(&cursor, LCD_CENT))
+ *				...
+ *			delay(20);
+ *		}
+ * @endcode
+ */
+void buttonCursorInit(buttoncursor_t* cursor);
+
+/**
+ * @brief Detects a press of a button that this cursor has not reported yet. Each press seen by buttonPoll is
+ *        reported exactly once per cursor; several presses since the last call are reported by successive calls.
+ *
+ * @return true if there was an unreported press
+ */
+bool buttonCursorIsNewPress(buttoncursor_t* cursor, button_t button);
+
+/**
+ * @brief Detects a release of a button that this cursor has not reported yet, like buttonCursorIsNewPress
+ *
+ * @return true if there was an unreported release
+ */
+bool buttonCursorIsNewRelease(buttoncursor_t* cursor, button_t button);
+
+/**
+ * @brief Sets the gesture timing of a button
+ *
+ * @param button
+ *        The button to configure
+ *
+ * @param hold
+ *        Milliseconds a press lasts before a BUTTON_HOLD event, 0 for BUTTON_HOLD_TIME
+ *
+ * @param doubleTap
+ *        Most milliseconds between two presses for a BUTTON_DOUBLE_TAP event, 0 for BUTTON_DOUBLE_TAP_TIME
+ */
+void buttonSetTiming(button_t button, unsigned int hold, unsigned int doubleTap);
+
+/**
+ * @brief Registers the handler of one event of one button. buttonPoll calls it from the task polling (see
+ *        buttonPollerStart) as soon as the event is detected, so it should return quickly. Events without a
+ *        handler are put in the queue read by buttonEventGet instead. Finding the handler of an event is a table
+ *        lookup, so the number of handlers does not slow down polling.
+ *
+ * Example code:
+ * @code
+ *		void toggleClaw(buttonevent_t event) {
+ *			...
+ *		}
+ *		...
+ *		buttonOnEvent(JOY1_8D, BUTTON_DOUBLE_TAP, toggleClaw);
+ *		buttonPollerStart(20);
+ * @endcode
+ *
+ * @param button
+ *        The button
+ *
+ * @param type
+ *        BUTTON_PRESS, BUTTON_RELEASE, BUTTON_HOLD or BUTTON_DOUBLE_TAP
+ *
+ * @param handler
+ *        Called with each event, or NULL to queue the events again
+ */
+void buttonOnEvent(button_t button, buttonevent_type_t type, buttonhandler_t handler);
+
+/**
+ * @brief Adds a chord: a BUTTON_CHORD event is generated when the last of its buttons goes down while the others
+ *        are held
+ *
+ * @param mask
+ *        The buttons of the chord, as BUTTON_MASK bits
+ *
+ * @param handler
+ *        Called with each event, or NULL to queue the events (see buttonOnEvent)
+ *
+ * @return The chord index given in its events, or -1 if there are already BUTTON_MAX_CHORDS chords
+ */
+int buttonChordAdd(unsigned int mask, buttonhandler_t handler);
+
+/**
+ * @brief Takes the oldest event from the queue of events without a handler. Only one task should read the queue.
+ *        When the queue is full, new events are dropped.
+ *
+ * @param event
+ *        Receives the event
+ *
+ * @return true if there was an event
+ */
+bool buttonEventGet(buttonevent_t* event);
+
 #endif
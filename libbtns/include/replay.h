@@ -0,0 +1,130 @@
+/**
+ * @file Team BLRS Buttons Library
+ *       > Input Record and Replay
+ * @brief Records the joystick inputs of a driver run and replays them later, e.g. for a skills autonomous
+ *
+ * Every poll of the button poller (buttonPollerStart) goes through inputPoll. While recording, each poll's button
+ * mask and joystick axes are appended to a buffer in RAM; while replaying, they come from a recording instead of the
+ * joysticks, so the buttons, events and axes read exactly as they did during the recorded run. Files are only read
+ * and written when a replay starts and a recording stops, never between polls.
+ *
+ * Recordings are compressed: a poll that repeats the previous one is added to a run (one byte for up to 128 polls),
+ * and a poll that differs stores only the axes that changed, in half a byte each for small changes, and the bytes of
+ * the button mask that changed. The time of a poll is only stored when it comes at another interval than the poll
+ * before it. With the sticks always moving, most polls change two or three axes and take about 3 bytes, so a minute
+ * at 20 ms takes about 9 KB, not the few KB a run with pauses can fit in; size the buffer for the longest run without
+ * pauses. A poller that is late by a few ms now and then adds about a byte per poll, so a jittery minute can take
+ * 12 KB.
+ *
+ * Example code:
+ * @code
+ *		static unsigned char recording[16384];
+ *		...
+ *		// in operatorControl
+ *		inputRecordStart(recording, sizeof(recording));
+ *		...
+ *		inputRecordStop("skills");
+ *		...
+ *		// in autonomous, running the operator control code
+ *		inputReplayStart("skills", recording, sizeof(recording));
+ *		while (inputReplaying())
+ *			...
+ * @endcode
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <API.h>
+#include "axes.h"
+#include "buttons.h"
+
+#define INPUT_MAGIC "BLIR"
+#define INPUT_VERSION 2
+
+/**
+ * The header of a recording file, followed by length bytes of polls
+ */
+typedef struct {
+	char magic[4];         // INPUT_MAGIC
+	unsigned char version; // INPUT_VERSION
+	unsigned char axes;    // AXIS_COUNT
+	unsigned short period; // average milliseconds between polls, for information
+	unsigned int polls;    // number of polls recorded
+	unsigned int length;   // number of bytes of polls
+} inputheader_t;
+
+/**
+ * @brief Reads the buttons and axes for one poll: from the recording being replayed, or else from the joysticks.
+ *        Records them if recording. Called by the button poller; call it followed by buttonUpdate and axisUpdate to
+ *        poll without the poller.
+ *
+ * @param buttons
+ *        Receives the buttons that are down, as BUTTON_MASK bits
+ *
+ * @param axes
+ *        Receives AXIS_COUNT joystick values, in the order of axis_t
+ */
+void inputPoll(unsigned int* buttons, signed char* axes);
+
+/**
+ * @brief Starts recording every poll. Recording stops by itself when the buffer is full.
+ *
+ * @param buffer
+ *        Receives the recording, and must stay valid until inputRecordStop
+ *
+ * @param size
+ *        Size of the buffer in bytes
+ */
+void inputRecordStart(unsigned char* buffer, unsigned int size);
+
+/**
+ * @brief Stops recording and saves the recording. A recording cut short by a full buffer is saved up to where it
+ *        stopped, but reported as not saved.
+ *
+ * @param file
+ *        Name of the file on the PROS flash filesystem, or NULL to discard the recording
+ *
+ * @return true if the whole recording was saved; false if it could not be saved, was discarded, was cut short, or
+ *         nothing was recorded since the last inputReplayStart
+ */
+bool inputRecordStop(const char* file);
+
+/**
+ * @return true while recording, false once stopped or the buffer is full
+ */
+bool inputRecording();
+
+/**
+ * @brief Loads a recording and starts replaying it from the next poll. Each poll is replayed at the time it was
+ *        recorded, counted from the first poll, and lasts until the next one: polls are skipped or repeated if the
+ *        poller runs at a different period than the recording.
+ *
+ * @param file
+ *        Name of the file on the PROS flash filesystem
+ *
+ * @param buffer
+ *        Receives the recording, and must stay valid until the replay ends
+ *
+ * @param size
+ *        Size of the buffer in bytes
+ *
+ * @return false if the file could not be read, is not a recording or does not fit in the buffer
+ */
+bool inputReplayStart(const char* file, unsigned char* buffer, unsigned int size);
+
+/**
+ * @brief Stops replaying. The next polls read the joysticks again.
+ */
+void inputReplayStop();
+
+/**
+ * @return true until the last recorded poll has been replayed
+ */
+bool inputReplaying();
+
+#endif
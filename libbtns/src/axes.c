@@ -0,0 +1,134 @@
+/**
+ * @file axes.c
+ *
+ * @details Every axis is read once per poll. Its value goes through the table of its deadzone and curve, then is
+ * slewed in fixed point, and the results of all the axes are published together under a sequence counter so that a
+ * snapshot never mixes two polls.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "axes.h"
+
+// Slew rates and slewed values have this many fractional bits
+#define AXIS_FRACTION_BITS 8
+
+/**
+ * Output of the deadzone and curve of each axis, indexed by the joystick value + 128
+ */
+static signed char axisTables[AXIS_COUNT][256];
+static volatile unsigned char axisCurved; // bit set for each axis using its table
+
+static unsigned int axisSlew[AXIS_COUNT]; // most change per millisecond, 0 for no limit
+static int axisPosition[AXIS_COUNT];      // slewed value
+static unsigned long axisLastPoll;
+
+/**
+ * The results of the latest poll. axisSeq is odd while they are being written.
+ */
+static volatile signed char axisRaw[AXIS_COUNT];
+static volatile signed char axisValues[AXIS_COUNT];
+static volatile unsigned int axisSeq;
+
+void axisSetCurve(axis_t axis, int deadzone, float expo) {
+	if (deadzone < 0)
+		deadzone = 0;
+	if (deadzone > 126)
+		deadzone = 126;
+	if (expo < 0)
+		expo = 0;
+	if (expo > 1)
+		expo = 1;
+
+	axisCurved &= ~(1U << axis); // pass the joystick value through while the table changes
+	__sync_synchronize();
+	signed char* table = axisTables[axis];
+	for (int x = -128; x < 128; x++) {
+		int magnitude = x < 0 ? -x : x;
+		int out = 0;
+		if (magnitude > deadzone) {
+			float u = (float)(magnitude - deadzone) / (127 - deadzone);
+			if (u > 1)
+				u = 1;
+			out = (int)(127 * ((1 - expo) * u + expo * u * u * u) + 0.5f);
+		}
+		table[x + 128] = x < 0 ? -out : out;
+	}
+	__sync_synchronize();
+	axisCurved |= 1U << axis;
+}
+
+void axisSetSlew(axis_t axis, float slew) {
+	if (slew < 0)
+		slew = -slew;
+	if (slew > 255)
+		slew = 255;
+	axisSlew[axis] = (unsigned int)(slew * (1 << AXIS_FRACTION_BITS));
+}
+
+void axisUpdate(const signed char* raw) {
+	unsigned long now = millis();
+	unsigned long dt = now - axisLastPoll;
+	axisLastPoll = now;
+	if (dt > 255) // keeps the step within range, an axis at most needs 255 / slew ms anyway
+		dt = 255;
+
+	axisSeq++;
+	__sync_synchronize();
+	for (int a = 0; a < AXIS_COUNT; a++) {
+		int value = (axisCurved & (1U << a)) ? axisTables[a][raw[a] + 128] : raw[a];
+		int target = value * (1 << AXIS_FRACTION_BITS);
+		if (axisSlew[a]) {
+			int step = axisSlew[a] * dt;
+			if (target > axisPosition[a])
+				axisPosition[a] = axisPosition[a] + step > target ? target : axisPosition[a] + step;
+			else
+				axisPosition[a] = axisPosition[a] - step < target ? target : axisPosition[a] - step;
+			value = axisPosition[a] / (1 << AXIS_FRACTION_BITS);
+		}
+		else
+			axisPosition[a] = target;
+		axisRaw[a] = raw[a];
+		axisValues[a] = value;
+	}
+	__sync_synchronize();
+	axisSeq++;
+}
+
+void axisRead(signed char* raw) {
+	for (int a = 0; a < AXIS_COUNT; a++) {
+		int value = joystickGetAnalog(a / 4 + 1, a % 4 + 1);
+		raw[a] = value < -127 ? -127 : (value > 127 ? 127 : value);
+	}
+}
+
+void axisPoll() {
+	signed char raw[AXIS_COUNT];
+	axisRead(raw);
+	axisUpdate(raw);
+}
+
+int axisGet(axis_t axis) {
+	return axisValues[axis];
+}
+
+int axisGetRaw(axis_t axis) {
+	return axisRaw[axis];
+}
+
+void axisGetSnapshot(signed char* values) {
+	unsigned int seq;
+	do {
+		seq = axisSeq;
+		if (seq & 1) { // the poller is writing; it may have been preempted by this task, so let it finish
+			taskDelay(1);
+			continue;
+		}
+		__sync_synchronize();
+		for (int a = 0; a < AXIS_COUNT; a++)
+			values[a] = axisValues[a];
+		__sync_synchronize();
+	} while ((seq & 1) || seq != axisSeq);
+}
@@ -13,112 +13,229 @@
  *
  ********************************************************************************/
 
+#include "axes.h"
 #include "buttons.h"
+#include "replay.h"
 
 /**
  * Represents the array of "wasPressed" for all 27 available buttons.
  */
 bool buttonPressed[27];
 
+/**
+ * The button group and location of each button of a joystick, in the order of button_t
+ */
+static const unsigned char buttonGroups[12] = {5, 5, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8};
+static const unsigned char buttonLocations[12] = {JOY_DOWN, JOY_UP, JOY_DOWN, JOY_UP, JOY_UP, JOY_LEFT,
+                                                  JOY_RIGHT, JOY_DOWN, JOY_UP, JOY_LEFT, JOY_RIGHT, JOY_DOWN};
+
+/**
+ * The latest snapshot of the buttons (see buttonPoll), one bit per button
+ */
+static unsigned int buttonState;
+static unsigned int buttonPressedMask;
+static unsigned int buttonReleasedMask;
+
+/**
+ * Number of presses and releases of each button. Only buttonPoll writes them, so any task can read them without a
+ * lock (aligned word accesses are atomic).
+ */
+static volatile unsigned int buttonPresses[BUTTON_COUNT];
+static volatile unsigned int buttonReleases[BUTTON_COUNT];
+
+static TaskHandle buttonPoller;
+static unsigned long buttonPollerPeriod;
+
+/**
+ * Gesture detection (see buttonOnEvent). Only buttonPoll writes the state, and only for the buttons that changed
+ * or are being held, so its cost does not depend on the number of handlers.
+ */
+static unsigned short buttonHoldTime[BUTTON_COUNT];    // 0 for BUTTON_HOLD_TIME
+static unsigned short buttonDoubleTapTime[BUTTON_COUNT]; // 0 for BUTTON_DOUBLE_TAP_TIME
+static unsigned long buttonPressTime[BUTTON_COUNT];   // millis() of the latest press
+static unsigned int buttonHoldPending;                // buttons down that have not reached their hold time
+static unsigned int buttonTapPending;                 // buttons whose next press may complete a double tap
+static buttonhandler_t buttonHandlers[BUTTON_COUNT][BUTTON_EVENT_TYPES];
+
+static unsigned int buttonChords[BUTTON_MAX_CHORDS];
+static buttonhandler_t buttonChordHandlers[BUTTON_MAX_CHORDS];
+static volatile int buttonChordCount;
+
+// Events without a handler, written by buttonPoll at buttonQueueHead and read by buttonEventGet at buttonQueueTail
+static buttonevent_t buttonQueue[BUTTON_QUEUE_SIZE];
+static volatile unsigned int buttonQueueHead, buttonQueueTail;
+
 /**
  * @brief Initializes the buttons array.
  */
 void buttonInit() {
 	for (int i = 0; i < 27; i++)
 		buttonPressed[i] = false;
+	buttonState = buttonPressedMask = buttonReleasedMask = 0;
+	buttonHoldPending = buttonTapPending = 0;
 }
 
 bool buttonGetState(button_t button) {
-	bool currentButton = false;
-
-	// Determine how to get the current button value (from what function) and where it
-	// is, then get it.
 	if (button < LCD_LEFT) {
-		// button is a joystick button
-		unsigned char joystick;
-		unsigned char buttonGroup;
-		unsigned char buttonLocation;
-
-		button_t newButton;
-		if (button <= 11) {
-			// button is on joystick 1
-			joystick = 1;
-			newButton = button;
-		}
-		else {
-			// button is on joystick 2
-			joystick = 2;
-			// shift button down to joystick 1 buttons in order to
-			// detect which button on joystick is queried
-			newButton = (button_t)(button - 12);
+		// button is a joystick button, buttons 12 and up are on joystick 2
+		unsigned char joystick = button < 12 ? 1 : 2;
+		return joystickGetDigital(joystick, buttonGroups[button % 12], buttonLocations[button % 12]);
+	}
+	// button is on LCD: LCD_BTN_LEFT, LCD_BTN_CENTER and LCD_BTN_RIGHT are bits 0, 1 and 2
+	return (lcdReadButtons(uart1) >> (button - LCD_LEFT)) & 1;
+}
+
+/**
+ * @brief Hands an event to its handler, or queues it if there is none
+ */
+static void _buttonEmit(buttonhandler_t handler, unsigned char type, unsigned char button, unsigned long time) {
+	buttonevent_t event = {time, button, type};
+	if (handler != NULL) {
+		handler(event);
+		return;
+	}
+	unsigned int head = buttonQueueHead;
+	if (head - buttonQueueTail >= BUTTON_QUEUE_SIZE)
+		return; // full
+	buttonQueue[head % BUTTON_QUEUE_SIZE] = event;
+	__sync_synchronize(); // the event must be complete before the reader can see it
+	buttonQueueHead = head + 1;
+}
+
+/**
+ * @brief Generates the events of the buttons that changed in the latest snapshot, and of the held buttons
+ */
+static void _buttonGestures(unsigned int previous, unsigned long now) {
+	for (unsigned int edges = buttonPressedMask; edges; edges &= edges - 1) {
+		int b = __builtin_ctz(edges);
+		_buttonEmit(buttonHandlers[b][BUTTON_PRESS], BUTTON_PRESS, b, now);
+		unsigned int window = buttonDoubleTapTime[b] ? buttonDoubleTapTime[b] : BUTTON_DOUBLE_TAP_TIME;
+		if ((buttonTapPending & BUTTON_MASK(b)) && now - buttonPressTime[b] <= window) {
+			_buttonEmit(buttonHandlers[b][BUTTON_DOUBLE_TAP], BUTTON_DOUBLE_TAP, b, now);
+			buttonTapPending &= ~BUTTON_MASK(b); // a third press starts a new double tap
 		}
+		else
+			buttonTapPending |= BUTTON_MASK(b);
+		buttonPressTime[b] = now;
+	}
+	buttonHoldPending = (buttonHoldPending | buttonPressedMask) & buttonState;
+
+	for (unsigned int edges = buttonReleasedMask; edges; edges &= edges - 1) {
+		int b = __builtin_ctz(edges);
+		_buttonEmit(buttonHandlers[b][BUTTON_RELEASE], BUTTON_RELEASE, b, now);
+	}
 
-		switch (newButton) {
-		case 0:
-			buttonGroup = 5;
-			buttonLocation = JOY_DOWN;
-			break;
-		case 1:
-			buttonGroup = 5;
-			buttonLocation = JOY_UP;
-			break;
-		case 2:
-			buttonGroup = 6;
-			buttonLocation = JOY_DOWN;
-			break;
-		case 3:
-			buttonGroup = 6;
-			buttonLocation = JOY_UP;
-			break;
-		case 4:
-			buttonGroup = 7;
-			buttonLocation = JOY_UP;
-			break;
-		case 5:
-			buttonGroup = 7;
-			buttonLocation = JOY_LEFT;
-			break;
-		case 6:
-			buttonGroup = 7;
-			buttonLocation = JOY_RIGHT;
-			break;
-		case 7:
-			buttonGroup = 7;
-			buttonLocation = JOY_DOWN;
-			break;
-		case 8:
-			buttonGroup = 8;
-			buttonLocation = JOY_UP;
-			break;
-		case 9:
-			buttonGroup = 8;
-			buttonLocation = JOY_LEFT;
-			break;
-		case 10:
-			buttonGroup = 8;
-			buttonLocation = JOY_RIGHT;
-			break;
-		case 11:
-			buttonGroup = 8;
-			buttonLocation = JOY_DOWN;
-			break;
-		default:
-			break;
+	for (unsigned int held = buttonHoldPending; held; held &= held - 1) {
+		int b = __builtin_ctz(held);
+		if (now - buttonPressTime[b] >= (buttonHoldTime[b] ? buttonHoldTime[b] : BUTTON_HOLD_TIME)) {
+			_buttonEmit(buttonHandlers[b][BUTTON_HOLD], BUTTON_HOLD, b, now);
+			buttonHoldPending &= ~BUTTON_MASK(b);
 		}
-		currentButton = joystickGetDigital(joystick, buttonGroup, buttonLocation);
 	}
-	else {
-		// button is on LCD
-		if (button == LCD_LEFT)
-			currentButton = (lcdReadButtons(uart1) == LCD_BTN_LEFT);
 
-		if (button == LCD_CENT)
-			currentButton = (lcdReadButtons(uart1) == LCD_BTN_CENTER);
+	if (buttonPressedMask) {
+		for (int c = 0; c < buttonChordCount; c++)
+			if ((buttonState & buttonChords[c]) == buttonChords[c] && (previous & buttonChords[c]) != buttonChords[c])
+				_buttonEmit(buttonChordHandlers[c], BUTTON_CHORD, c, now);
+	}
+}
+
+unsigned int buttonRead() {
+	unsigned int state = 0;
+	for (int button = 0; button < LCD_LEFT; button++)
+		if (joystickGetDigital(button < 12 ? 1 : 2, buttonGroups[button % 12], buttonLocations[button % 12]))
+			state |= BUTTON_MASK(button);
+	return state | (lcdReadButtons(uart1) & (LCD_BTN_LEFT | LCD_BTN_CENTER | LCD_BTN_RIGHT)) << LCD_LEFT;
+}
 
-		if (button == LCD_RIGHT)
-			currentButton = (lcdReadButtons(uart1) == LCD_BTN_RIGHT);
+unsigned int buttonPoll() {
+	return buttonUpdate(buttonRead());
+}
+
+unsigned int buttonUpdate(unsigned int state) {
+	unsigned int previous = buttonState;
+	unsigned int changed = state ^ previous;
+	buttonPressedMask = changed & state;
+	buttonReleasedMask = changed & previous;
+	buttonState = state;
+	// Only the buttons that changed are visited, lowest bit first
+	for (unsigned int edges = buttonPressedMask; edges; edges &= edges - 1)
+		buttonPresses[__builtin_ctz(edges)]++;
+	for (unsigned int edges = buttonReleasedMask; edges; edges &= edges - 1)
+		buttonReleases[__builtin_ctz(edges)]++;
+	_buttonGestures(previous, millis());
+	return state;
+}
+
+static void _buttonPollerTask(void* none) {
+	unsigned long now = millis();
+	while (true) {
+		unsigned int buttons;
+		signed char axes[AXIS_COUNT];
+		inputPoll(&buttons, axes); // from the joysticks, or from a replay
+		buttonUpdate(buttons);
+		axisUpdate(axes);
+		taskDelayUntil(&now, buttonPollerPeriod);
 	}
-	return currentButton;
+}
+
+TaskHandle buttonPollerStart(unsigned long period) {
+	if (buttonPoller != NULL)
+		return NULL;
+	buttonPollerPeriod = period ? period : 1;
+	buttonPoller = taskCreate(_buttonPollerTask, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+	return buttonPoller;
+}
+
+void buttonPollerStop() {
+	if (buttonPoller != NULL) // passing NULL kills current thread, so don't allow that to happen
+		taskDelete(buttonPoller);
+	buttonPoller = NULL;
+}
+
+unsigned int buttonGetPressCount(button_t button) {
+	return buttonPresses[button];
+}
+
+void buttonCursorInit(buttoncursor_t* cursor) {
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		cursor->presses[i] = buttonPresses[i];
+		cursor->releases[i] = buttonReleases[i];
+	}
+}
+
+bool buttonCursorIsNewPress(buttoncursor_t* cursor, button_t button) {
+	if (cursor->presses[button] == buttonPresses[button])
+		return false;
+	cursor->presses[button]++;
+	return true;
+}
+
+bool buttonCursorIsNewRelease(buttoncursor_t* cursor, button_t button) {
+	if (cursor->releases[button] == buttonReleases[button])
+		return false;
+	cursor->releases[button]++;
+	return true;
+}
+
+bool buttonIsDown(button_t button) {
+	return buttonState & BUTTON_MASK(button);
+}
+
+bool buttonIsPressed(button_t button) {
+	return buttonPressedMask & BUTTON_MASK(button);
+}
+
+bool buttonIsReleased(button_t button) {
+	return buttonReleasedMask & BUTTON_MASK(button);
+}
+
+unsigned int buttonGetPressedMask() {
+	return buttonPressedMask;
+}
+
+unsigned int buttonGetReleasedMask() {
+	return buttonReleasedMask;
 }
 
 /**
@@ -152,3 +269,34 @@ bool buttonIsNewPress(button_t button) {
 	else
 		return false; // button is not pressed or was already detected
 }
+
+void buttonSetTiming(button_t button, unsigned int hold, unsigned int doubleTap) {
+	buttonHoldTime[button] = hold > 65535 ? 65535 : hold;
+	buttonDoubleTapTime[button] = doubleTap > 65535 ? 65535 : doubleTap;
+}
+
+void buttonOnEvent(button_t button, buttonevent_type_t type, buttonhandler_t handler) {
+	if (type < BUTTON_EVENT_TYPES)
+		buttonHandlers[button][type] = handler;
+}
+
+int buttonChordAdd(unsigned int mask, buttonhandler_t handler) {
+	int c = buttonChordCount;
+	if (c >= BUTTON_MAX_CHORDS)
+		return -1;
+	buttonChords[c] = mask;
+	buttonChordHandlers[c] = handler;
+	__sync_synchronize(); // the chord must be complete before buttonPoll can see it
+	buttonChordCount = c + 1;
+	return c;
+}
+
+bool buttonEventGet(buttonevent_t* event) {
+	unsigned int tail = buttonQueueTail;
+	if (tail == buttonQueueHead)
+		return false;
+	__sync_synchronize(); // read the event only after seeing that it is complete
+	*event = buttonQueue[tail % BUTTON_QUEUE_SIZE];
+	buttonQueueTail = tail + 1;
+	return true;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file replay.c
+ *
+ * @details A recording is a sequence of polls, each starting with a tag byte:
+ *   - INPUT_RUN set: this poll and the next (tag & 0x7F) repeat the previous poll, and its time since the poll before
+ *   - otherwise, if INPUT_TIME is set, the time since the previous poll in ms follows: one byte, or INPUT_TIME_WIDE
+ *     followed by two bytes, low first. Without it, the time is the same as for the previous poll.
+ *   - then, if INPUT_AXES is set, a mask of the axes that changed follows, then the change of each changed axis. With
+ *     INPUT_SMALL set, every change is within -8 to 7 and two share a byte, the first in the low nibble. Otherwise each
+ *     takes a byte, or INPUT_ESCAPE followed by its value when the change does not fit in a byte.
+ *   - for each of bits 1-4 set, the XOR of the corresponding byte of the button mask follows.
+ * The first poll is compared against a poll at time 0 with no button down and every axis at 0.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "replay.h"
+#include <string.h>
+
+#define INPUT_RUN 0x80
+#define INPUT_AXES 0x01
+#define INPUT_TIME 0x20
+#define INPUT_SMALL 0x40
+#define INPUT_ESCAPE 0x80
+#define INPUT_TIME_WIDE 0xFF
+#define INPUT_POLL_MAX (1 + 3 + 1 + 2 * AXIS_COUNT + 4) // longest encoding of a poll in bytes
+
+#define INPUT_LIVE 0
+#define INPUT_RECORD 1
+#define INPUT_REPLAY 2
+
+static volatile unsigned char inputMode; // INPUT_LIVE, INPUT_RECORD or INPUT_REPLAY
+static unsigned char* inputBuffer;
+static unsigned int inputSize;
+static unsigned int inputLength;   // bytes recorded, or bytes of the recording being replayed
+static unsigned int inputPosition; // next byte to replay
+static bool inputRecorded;  // the buffer holds a recording, started by inputRecordStart
+static bool inputTruncated; // the recording stopped because the buffer filled up
+
+// The previous poll, which each encoded poll is relative to
+static unsigned int inputButtons;
+static signed char inputAxes[AXIS_COUNT];
+
+static unsigned int inputRun;   // recording: polls repeating the previous one not yet written; replay: left to repeat
+static unsigned int inputPolls; // polls recorded, or polls replayed so far
+static unsigned int inputTotal; // polls in the recording being replayed
+static unsigned short inputDelta; // ms between the previous poll and the one before it
+static unsigned long inputStart;  // millis() of the first poll, recorded or replayed
+static unsigned long inputTime;   // recording: millis() of the previous poll; replay: its time from the first poll
+static bool inputStarted;         // the replay has had its first poll
+
+/**
+ * @brief Resets the encoding state to the start of a recording
+ */
+static void _inputReset() {
+	inputButtons = 0;
+	memset(inputAxes, 0, sizeof(inputAxes));
+	inputRun = 0;
+	inputPolls = 0;
+	inputDelta = 0;
+	inputTime = 0;
+	inputPosition = 0;
+	inputStarted = false;
+}
+
+static void _inputFlushRun() {
+	if (inputRun) {
+		inputBuffer[inputLength++] = INPUT_RUN | (inputRun - 1);
+		inputRun = 0;
+	}
+}
+
+/**
+ * @brief Appends a poll to the recording
+ */
+static void _inputRecord(unsigned int buttons, const signed char* axes, unsigned long now) {
+	if (inputLength + 1 + INPUT_POLL_MAX > inputSize) { // full, including a pending run
+		inputTruncated = true;
+		inputMode = INPUT_LIVE;
+		return;
+	}
+	if (inputPolls == 0)
+		inputStart = inputTime = now;
+	unsigned long delta = now - inputTime;
+	if (delta > 0xFFFF)
+		delta = 0xFFFF;
+	inputTime = now;
+	inputPolls++;
+
+	unsigned int changed = buttons ^ inputButtons;
+	unsigned char mask = 0;
+	bool small = true;
+	for (int a = 0; a < AXIS_COUNT; a++) {
+		int change = axes[a] - inputAxes[a];
+		if (change) {
+			mask |= 1U << a;
+			small = small && change >= -8 && change <= 7;
+		}
+	}
+	if (!changed && !mask && delta == inputDelta) {
+		if (++inputRun == 128)
+			_inputFlushRun();
+		return;
+	}
+
+	_inputFlushRun();
+	unsigned char* tag = &inputBuffer[inputLength];
+	unsigned char* out = tag + 1;
+	*tag = 0;
+	if (delta != inputDelta) {
+		*tag |= INPUT_TIME;
+		if (delta >= INPUT_TIME_WIDE) {
+			*out++ = INPUT_TIME_WIDE;
+			*out++ = delta;
+			*out++ = delta >> 8;
+		}
+		else
+			*out++ = delta;
+		inputDelta = delta;
+	}
+	if (mask) {
+		*tag |= INPUT_AXES | (small ? INPUT_SMALL : 0);
+		*out++ = mask;
+		int nibble = 0;
+		for (int a = 0; a < AXIS_COUNT; a++) {
+			if (!(mask & (1U << a)))
+				continue;
+			int change = axes[a] - inputAxes[a];
+			if (small) {
+				if (nibble++ % 2 == 0)
+					*out++ = change & 0x0F;
+				else
+					out[-1] |= (change & 0x0F) << 4;
+			}
+			else if (change < -127 || change > 127) {
+				*out++ = INPUT_ESCAPE;
+				*out++ = axes[a];
+			}
+			else
+				*out++ = change;
+			inputAxes[a] = axes[a];
+		}
+	}
+	for (int b = 0; b < 4; b++) {
+		if ((changed >> (8 * b)) & 0xFF) {
+			*tag |= 2 << b;
+			*out++ = changed >> (8 * b);
+		}
+	}
+	inputButtons = buttons;
+	inputLength = out - inputBuffer;
+}
+
+static unsigned char _inputByte() {
+	return inputPosition < inputLength ? inputBuffer[inputPosition++] : 0;
+}
+
+static unsigned char _inputPeek(unsigned int offset) {
+	return inputPosition + offset < inputLength ? inputBuffer[inputPosition + offset] : 0;
+}
+
+/**
+ * @brief Reads the time between the previous poll and the next one without decoding the next one
+ */
+static unsigned short _inputNextDelta() {
+	unsigned char tag = _inputPeek(0);
+	if (inputRun || (tag & INPUT_RUN) || !(tag & INPUT_TIME))
+		return inputDelta;
+	if (_inputPeek(1) != INPUT_TIME_WIDE)
+		return _inputPeek(1);
+	return _inputPeek(2) | _inputPeek(3) << 8;
+}
+
+/**
+ * @brief Advances the previous poll by one poll of the recording
+ */
+static void _inputDecode() {
+	if (inputRun) {
+		inputRun--;
+		return;
+	}
+	unsigned char tag = _inputByte();
+	if (tag & INPUT_RUN) {
+		inputRun = tag & 0x7F;
+		return;
+	}
+	if (tag & INPUT_TIME) {
+		inputDelta = _inputByte();
+		if (inputDelta == INPUT_TIME_WIDE) {
+			inputDelta = _inputByte();
+			inputDelta |= _inputByte() << 8;
+		}
+	}
+	if (tag & INPUT_AXES) {
+		unsigned char mask = _inputByte();
+		int nibble = 0;
+		unsigned char pair = 0;
+		for (int a = 0; a < AXIS_COUNT; a++) {
+			if (!(mask & (1U << a)))
+				continue;
+			if (tag & INPUT_SMALL) {
+				if (nibble++ % 2 == 0)
+					pair = _inputByte();
+				else
+					pair >>= 4;
+				inputAxes[a] += (signed char)(pair << 4) >> 4; // sign extends the low nibble
+				continue;
+			}
+			unsigned char change = _inputByte();
+			if (change == INPUT_ESCAPE)
+				inputAxes[a] = (signed char)_inputByte();
+			else
+				inputAxes[a] += (signed char)change;
+		}
+	}
+	for (int b = 0; b < 4; b++)
+		if (tag & (2 << b))
+			inputButtons ^= (unsigned int)_inputByte() << (8 * b);
+}
+
+void inputPoll(unsigned int* buttons, signed char* axes) {
+	unsigned long now = millis();
+	if (inputMode == INPUT_REPLAY) {
+		if (!inputStarted) {
+			inputStarted = true;
+			inputStart = now;
+		}
+		// Each poll of the recording is due as long after the first one as it was recorded, and lasts until the next
+		// one, or for the time since the poll before it if it is the last
+		unsigned long elapsed = now - inputStart;
+		while (inputPolls < inputTotal && inputTime + _inputNextDelta() <= elapsed) {
+			inputTime += _inputNextDelta();
+			_inputDecode();
+			inputPolls++;
+		}
+		if (inputPolls < inputTotal || elapsed - inputTime < inputDelta) {
+			*buttons = inputButtons;
+			memcpy(axes, inputAxes, AXIS_COUNT);
+			return;
+		}
+		inputMode = INPUT_LIVE; // the recording is over
+	}
+
+	*buttons = buttonRead();
+	axisRead(axes);
+	if (inputMode == INPUT_RECORD)
+		_inputRecord(*buttons, axes, now);
+}
+
+void inputRecordStart(unsigned char* buffer, unsigned int size) {
+	inputMode = INPUT_LIVE;
+	__sync_synchronize();
+	inputBuffer = buffer;
+	inputSize = size;
+	inputLength = 0;
+	inputRecorded = true;
+	inputTruncated = false;
+	_inputReset();
+	__sync_synchronize();
+	inputMode = INPUT_RECORD;
+}
+
+bool inputRecordStop(const char* file) {
+	if (inputMode == INPUT_RECORD)
+		inputMode = INPUT_LIVE;
+	__sync_synchronize();
+	if (!inputRecorded || file == NULL) // the buffer may hold a replay instead
+		return false;
+	_inputFlushRun();
+
+	inputheader_t header;
+	memcpy(header.magic, INPUT_MAGIC, 4);
+	header.version = INPUT_VERSION;
+	header.axes = AXIS_COUNT;
+	header.period = inputPolls > 1 ? (inputTime - inputStart + (inputPolls - 1) / 2) / (inputPolls - 1) : 0;
+	header.polls = inputPolls;
+	header.length = inputLength;
+
+	FILE* out = fopen(file, "w");
+	if (out == NULL)
+		return false;
+	bool saved = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(inputBuffer, 1, inputLength, out) == inputLength;
+	fclose(out);
+	return saved && !inputTruncated;
+}
+
+bool inputRecording() {
+	return inputMode == INPUT_RECORD;
+}
+
+bool inputReplayStart(const char* file, unsigned char* buffer, unsigned int size) {
+	inputMode = INPUT_LIVE;
+	inputRecorded = false;
+	__sync_synchronize();
+	FILE* in = fopen(file, "r");
+	if (in == NULL)
+		return false;
+	inputheader_t header;
+	bool loaded = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, INPUT_MAGIC, 4) == 0 &&
+	              header.version == INPUT_VERSION && header.axes == AXIS_COUNT && header.length <= size &&
+	              fread(buffer, 1, header.length, in) == header.length;
+	fclose(in);
+	if (!loaded)
+		return false;
+
+	inputBuffer = buffer;
+	inputSize = size;
+	inputLength = header.length;
+	inputTotal = header.polls;
+	_inputReset();
+	__sync_synchronize();
+	inputMode = INPUT_REPLAY;
+	return true;
+}
+
+void inputReplayStop() {
+	if (inputMode == INPUT_REPLAY)
+		inputMode = INPUT_LIVE;
+}
+
+bool inputReplaying() {
+	return inputMode == INPUT_REPLAY;
+}
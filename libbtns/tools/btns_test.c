@@ -0,0 +1,266 @@
+/**
+ * @file Team BLRS Buttons Library
+ *       > Host Tests
+ * @brief Checks the button events generated by buttonUpdate on a computer: presses and releases, double taps at the
+ *        edge of their window, holds at their threshold, a third press after a double tap, chords, and the queue
+ *        filling up
+ *
+ * Each test feeds buttonUpdate button masks at chosen times, as the poller would, and reads the events back with
+ * buttonEventGet. No handlers are registered, so every event goes through the queue. millis() is a stand-in that
+ * returns the simulated time, so the tests do not depend on how fast the computer is.
+ *
+ * Build and run from the libbtns directory with "make hosttest", or:
+ *		gcc -std=gnu99 -Iinclude -o btns_test tools/btns_test.c src/buttons.c src/axes.c src/replay.c
+ *
+ * Usage:
+ *		btns_test
+ *
+ * The exit status is 1 if any check fails.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "buttons.h"
+
+static unsigned int checks, failures;
+
+#define CHECK(condition, ...)                                                                                          \
+	do {                                                                                                               \
+		checks++;                                                                                                      \
+		if (!(condition)) {                                                                                            \
+			failures++;                                                                                                \
+			printf("FAIL %s:%d: ", __func__, __LINE__);                                                                \
+			printf(__VA_ARGS__);                                                                                       \
+			printf("\n");                                                                                              \
+		}                                                                                                              \
+	} while (0)
+
+// The simulated clock
+static unsigned long now;
+
+// Stand-ins for the PROS functions used by libbtns; the joysticks are never read, buttonUpdate is given the buttons
+bool joystickGetDigital(unsigned char joystick, unsigned char buttonGroup, unsigned char button) {
+	return false;
+}
+
+int joystickGetAnalog(unsigned char joystick, unsigned char axis) {
+	return 0;
+}
+
+unsigned int lcdReadButtons(FILE* lcdPort) {
+	return 0;
+}
+
+unsigned long millis() {
+	return now;
+}
+
+void taskDelay(const unsigned long msToDelay) {
+	now += msToDelay;
+}
+
+void taskDelayUntil(unsigned long* previousWakeTime, const unsigned long cycleTime) {
+	*previousWakeTime += cycleTime;
+}
+
+TaskHandle taskCreate(TaskCode taskCode, const unsigned int stackDepth, void* parameters,
+                      const unsigned int priority) {
+	return NULL;
+}
+
+void taskDelete(TaskHandle taskToDelete) {
+}
+
+static const char* const types[] = {"press", "release", "hold", "double tap", "chord"};
+
+// Polls the buttons at a time
+static void _update(unsigned long time, unsigned int state) {
+	now = time;
+	buttonUpdate(state);
+}
+
+// Empties the queue
+static void _drain() {
+	buttonevent_t event;
+	while (buttonEventGet(&event))
+		;
+}
+
+// Releases every button and empties the queue, then moves the clock well past any double tap or hold time
+static void _reset() {
+	_update(now, 0);
+	_drain();
+	buttonInit();
+	now += 10000;
+}
+
+// Takes the next event from the queue and checks that it is the expected one
+#define EXPECT(type_, button_, time_)                                                                                  \
+	do {                                                                                                               \
+		buttonevent_t event;                                                                                           \
+		bool got = buttonEventGet(&event);                                                                             \
+		CHECK(got && event.type == (type_) && event.button == (button_) && event.time == (time_),                      \
+		      "expected %s of %d at %lu, got %s", types[type_], button_, (unsigned long)(time_),                      \
+		      got ? types[event.type] : "no event");                                                                   \
+	} while (0)
+
+#define EXPECT_NONE()                                                                                                  \
+	do {                                                                                                               \
+		buttonevent_t event;                                                                                           \
+		bool got = buttonEventGet(&event);                                                                             \
+		CHECK(!got, "expected no event, got %s of %d at %lu", types[event.type], event.button, event.time);           \
+	} while (0)
+
+// A press and a release each give one event, at the time of the poll that saw them
+static void _testPressRelease() {
+	_reset();
+	unsigned long t = now;
+	_update(t, BUTTON_MASK(JOY1_8D));
+	EXPECT(BUTTON_PRESS, JOY1_8D, t);
+	EXPECT_NONE();
+	_update(t + 20, BUTTON_MASK(JOY1_8D));
+	EXPECT_NONE();
+	_update(t + 100, 0);
+	EXPECT(BUTTON_RELEASE, JOY1_8D, t + 100);
+	EXPECT_NONE();
+}
+
+// A second press BUTTON_DOUBLE_TAP_TIME after the first is a double tap, one ms later it is not
+static void _testDoubleTap() {
+	_reset();
+	unsigned long t = now;
+	_update(t, BUTTON_MASK(JOY1_8U));
+	_update(t + 100, 0);
+	_update(t + BUTTON_DOUBLE_TAP_TIME, BUTTON_MASK(JOY1_8U));
+	EXPECT(BUTTON_PRESS, JOY1_8U, t);
+	EXPECT(BUTTON_RELEASE, JOY1_8U, t + 100);
+	EXPECT(BUTTON_PRESS, JOY1_8U, t + BUTTON_DOUBLE_TAP_TIME);
+	EXPECT(BUTTON_DOUBLE_TAP, JOY1_8U, t + BUTTON_DOUBLE_TAP_TIME);
+	EXPECT_NONE();
+
+	_reset();
+	t = now;
+	_update(t, BUTTON_MASK(JOY1_8U));
+	_update(t + 100, 0);
+	_update(t + BUTTON_DOUBLE_TAP_TIME + 1, BUTTON_MASK(JOY1_8U));
+	EXPECT(BUTTON_PRESS, JOY1_8U, t);
+	EXPECT(BUTTON_RELEASE, JOY1_8U, t + 100);
+	EXPECT(BUTTON_PRESS, JOY1_8U, t + BUTTON_DOUBLE_TAP_TIME + 1);
+	EXPECT_NONE();
+}
+
+// A third press right after a double tap starts a new one, which the fourth press completes
+static void _testThirdPress() {
+	_reset();
+	unsigned long t = now;
+	for (int press = 0; press < 4; press++) {
+		_update(t + press * 100, BUTTON_MASK(JOY2_7L));
+		_update(t + press * 100 + 50, 0);
+	}
+	for (int press = 0; press < 4; press++) {
+		EXPECT(BUTTON_PRESS, JOY2_7L, t + press * 100);
+		if (press % 2 == 1)
+			EXPECT(BUTTON_DOUBLE_TAP, JOY2_7L, t + press * 100);
+		EXPECT(BUTTON_RELEASE, JOY2_7L, t + press * 100 + 50);
+	}
+	EXPECT_NONE();
+}
+
+// A held button gives one hold event at the first poll BUTTON_HOLD_TIME after the press, and none for a press
+// released just before
+static void _testHold() {
+	_reset();
+	unsigned long t = now;
+	_update(t, BUTTON_MASK(LCD_CENT));
+	_update(t + BUTTON_HOLD_TIME - 1, BUTTON_MASK(LCD_CENT));
+	EXPECT(BUTTON_PRESS, LCD_CENT, t);
+	EXPECT_NONE();
+	_update(t + BUTTON_HOLD_TIME, BUTTON_MASK(LCD_CENT));
+	EXPECT(BUTTON_HOLD, LCD_CENT, t + BUTTON_HOLD_TIME);
+	_update(t + 2 * BUTTON_HOLD_TIME, BUTTON_MASK(LCD_CENT));
+	EXPECT_NONE();
+	_update(t + 2 * BUTTON_HOLD_TIME + 20, 0);
+	EXPECT(BUTTON_RELEASE, LCD_CENT, t + 2 * BUTTON_HOLD_TIME + 20);
+
+	_reset();
+	t = now;
+	_update(t, BUTTON_MASK(LCD_CENT));
+	_update(t + BUTTON_HOLD_TIME - 1, 0);
+	_update(t + BUTTON_HOLD_TIME, 0);
+	EXPECT(BUTTON_PRESS, LCD_CENT, t);
+	EXPECT(BUTTON_RELEASE, LCD_CENT, t + BUTTON_HOLD_TIME - 1);
+	EXPECT_NONE();
+}
+
+// A chord fires when its last button goes down while the others are held, after the press events of that poll,
+// and again each time it is completed
+static void _testChord() {
+	_reset();
+	unsigned int chord = BUTTON_MASK(JOY1_5U) | BUTTON_MASK(JOY1_6U);
+	int c = buttonChordAdd(chord, NULL);
+	CHECK(c >= 0, "could not add a chord");
+	unsigned long t = now;
+	_update(t, BUTTON_MASK(JOY1_5U));
+	_update(t + 100, chord);
+	EXPECT(BUTTON_PRESS, JOY1_5U, t);
+	EXPECT(BUTTON_PRESS, JOY1_6U, t + 100);
+	EXPECT(BUTTON_CHORD, c, t + 100);
+	EXPECT_NONE();
+
+	_update(t + 200, chord | BUTTON_MASK(JOY1_8L)); // another button while the chord is held does not repeat it
+	EXPECT(BUTTON_PRESS, JOY1_8L, t + 200);
+	EXPECT_NONE();
+
+	_update(t + 300, BUTTON_MASK(JOY1_6U));
+	_update(t + 400, chord);
+	EXPECT(BUTTON_RELEASE, JOY1_5U, t + 300);
+	EXPECT(BUTTON_RELEASE, JOY1_8L, t + 300);
+	EXPECT(BUTTON_PRESS, JOY1_5U, t + 400);
+	EXPECT(BUTTON_CHORD, c, t + 400);
+	EXPECT_NONE();
+
+	_update(t + 10000, 0);
+	_drain();
+	_update(t + 20000, chord); // both at once
+	EXPECT(BUTTON_PRESS, JOY1_5U, t + 20000);
+	EXPECT(BUTTON_PRESS, JOY1_6U, t + 20000);
+	EXPECT(BUTTON_CHORD, c, t + 20000);
+	EXPECT_NONE();
+}
+
+// Events past BUTTON_QUEUE_SIZE are dropped, the queued ones are kept in order, and the queue works again once read
+static void _testQueueFull() {
+	_reset();
+	unsigned long t = now;
+	int presses = BUTTON_QUEUE_SIZE / 2 + 4; // each press and release is two events
+	for (int press = 0; press < presses; press++) {
+		_update(t + press * 1000, BUTTON_MASK(JOY2_8R));
+		_update(t + press * 1000 + 100, 0);
+	}
+	for (int press = 0; press < BUTTON_QUEUE_SIZE / 2; press++) {
+		EXPECT(BUTTON_PRESS, JOY2_8R, t + press * 1000);
+		EXPECT(BUTTON_RELEASE, JOY2_8R, t + press * 1000 + 100);
+	}
+	EXPECT_NONE();
+
+	t += presses * 1000;
+	_update(t, BUTTON_MASK(JOY2_8R));
+	EXPECT(BUTTON_PRESS, JOY2_8R, t);
+	EXPECT_NONE();
+}
+
+int main() {
+	buttonInit();
+
+	_testPressRelease();
+	_testDoubleTap();
+	_testThirdPress();
+	_testHold();
+	_testChord();
+	_testQueueFull();
+
+	printf("%u checks, %u failed\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file Team BLRS Buttons Library
+ *       > Host Record and Replay Round Trip
+ * @brief Records simulated driver runs with replay.h, saves and reloads them, and checks that every replayed poll
+ *        matches the recorded one
+ *
+ * Each run is a minute of simulated driving: the sticks move smoothly, with pauses in some runs, and buttons change
+ * every few polls. It is polled through inputPoll every 20 ms, or at 18 to 22 ms like a poller that is sometimes
+ * late. The recording is then replayed by a poller with the same times, pollers every 10, 20 and 30 ms, and a
+ * poller with its own jitter. At each replayed poll the buttons and axes must be those of the latest recorded poll
+ * due by then, counting time from the first poll, and the replay must end one poll after the last recorded poll.
+ *
+ * Build from the libbtns directory:
+ *		gcc -std=gnu99 -Iinclude -o replay_roundtrip tools/replay_roundtrip.c src/buttons.c src/axes.c src/replay.c -lm
+ *
+ * Usage:
+ *		replay_roundtrip [directory]
+ *
+ * The recordings are saved as replay_roundtrip.rec in the directory, by default the current one. Then it checks
+ * that stopping a recording during a replay leaves that file alone, and that a recording cut short by a tiny buffer
+ * is saved as replay_roundtrip.cut but reported as not saved whole.
+ *
+ * The exit status is 1 if any replayed poll differs from the recording or either check fails.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "replay.h"
+#include <math.h>
+#include <string.h>
+
+#define RUN_TIME 60000 // ms of driving in each recording
+#define MAX_POLLS 8000
+#define BUFFER_SIZE 16384
+#define RUNS 3
+#define POLLERS 5
+
+// The simulated joysticks and clock
+static unsigned int joystickButtons; // bit (joystick - 1) * 16 + (group - 5) * 4 + location bit
+static unsigned int lcdButtons;
+static int joystickAxes[2][4];
+static unsigned long now;
+
+// Stand-ins for the PROS functions used by libbtns
+bool joystickGetDigital(unsigned char joystick, unsigned char buttonGroup, unsigned char button) {
+	return (joystickButtons >> ((joystick - 1) * 16 + (buttonGroup - 5) * 4 + __builtin_ctz(button))) & 1;
+}
+
+int joystickGetAnalog(unsigned char joystick, unsigned char axis) {
+	return joystickAxes[joystick - 1][axis - 1];
+}
+
+unsigned int lcdReadButtons(FILE* lcdPort) {
+	return lcdButtons;
+}
+
+unsigned long millis() {
+	return now;
+}
+
+void taskDelay(const unsigned long msToDelay) {
+	now += msToDelay;
+}
+
+void taskDelayUntil(unsigned long* previousWakeTime, const unsigned long cycleTime) {
+	*previousWakeTime += cycleTime;
+}
+
+TaskHandle taskCreate(TaskCode taskCode, const unsigned int stackDepth, void* parameters,
+                      const unsigned int priority) {
+	return NULL;
+}
+
+void taskDelete(TaskHandle taskToDelete) {
+}
+
+// The recorded polls: time from the first poll, buttons and axes
+static unsigned long recordTime[MAX_POLLS];
+static unsigned int recordButtons[MAX_POLLS];
+static signed char recordAxes[MAX_POLLS][AXIS_COUNT];
+
+static unsigned char recording[BUFFER_SIZE], loaded[BUFFER_SIZE];
+
+static const char* const runs[RUNS] = {"moving, 20 ms", "pauses, 20 ms", "moving, 18-22 ms"};
+static const char* const pollers[POLLERS] = {"recorded", "10 ms", "20 ms", "30 ms", "5-35 ms"};
+
+static unsigned long _random(unsigned int* seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+// Time until the next poll of a run or a replay poller
+static unsigned long _interval(bool jitter, unsigned long period, unsigned long spread, unsigned int* seed) {
+	return jitter ? period - spread + _random(seed) % (2 * spread + 1) : period;
+}
+
+// Moves the simulated sticks and buttons to their state at time t of a run
+static void _drive(int run, unsigned long t, unsigned int* seed) {
+	double phase = t / 2000.0;
+	bool paused = run == 1 && (t / 3000) % 2 == 1; // the driver lets go of the sticks every other 3 s
+	joystickAxes[0][2] = paused ? 0 : (int)(127 * sin(phase));
+	joystickAxes[0][3] = paused || (t / 1000) % 4 == 0 ? 0 : (int)(60 * cos(phase * 3));
+	joystickAxes[0][1] = paused || t % 8000 < 4000 ? 0 : joystickAxes[0][2] / 2;
+	joystickAxes[1][0] = (t / 5000) % 3 == 1 ? (int)(-127 * sin(phase / 2)) : 0;
+	if (_random(seed) % 40 == 0)
+		joystickButtons ^= 1U << _random(seed) % 32;
+	if (_random(seed) % 400 == 0)
+		lcdButtons ^= 1U << _random(seed) % 3;
+}
+
+// Records a run, saves it and loads it back; returns the number of polls recorded
+static unsigned int _record(int run, const char* file, unsigned int* length) {
+	unsigned int seed = run + 1;
+	joystickButtons = lcdButtons = 0;
+	now = 1000; // the recording does not start at time 0
+	unsigned long start = now;
+	inputRecordStart(recording, sizeof(recording));
+	unsigned int polls = 0;
+	while (now - start < RUN_TIME && polls < MAX_POLLS) {
+		_drive(run, now - start, &seed);
+		recordTime[polls] = now - start;
+		inputPoll(&recordButtons[polls], recordAxes[polls]);
+		polls++;
+		now += _interval(run == 2, 20, 2, &seed);
+	}
+	if (!inputRecording())
+		printf("%s: the buffer filled up\n", runs[run]);
+	inputheader_t header;
+	FILE* in;
+	if (!inputRecordStop(file) || (in = fopen(file, "r")) == NULL) {
+		printf("%s: could not save %s\n", runs[run], file);
+		return 0;
+	}
+	*length = fread(&header, sizeof(header), 1, in) == 1 ? header.length : 0;
+	fclose(in);
+	return polls;
+}
+
+// Replays a recording of polls polls with a poller, and returns the number of differing polls
+static unsigned long _replay(const char* file, unsigned int polls, int poller, unsigned long* replayed) {
+	static const unsigned long periods[POLLERS] = {0, 10, 20, 30, 20};
+	unsigned int seed = poller * 7 + 3;
+	// The joysticks hold values a replay must not show
+	joystickButtons = 0xFFFFFFFF;
+	lcdButtons = 7;
+	joystickAxes[0][2] = joystickAxes[1][0] = 100;
+	now = 50000;
+	if (!inputReplayStart(file, loaded, sizeof(loaded)))
+		return polls;
+
+	unsigned long start = now, failures = 0, end = 2 * recordTime[polls - 1] - recordTime[polls - 2];
+	unsigned int due = 0, k = 0;
+	*replayed = 0;
+	while (true) {
+		unsigned long t = now - start;
+		while (due + 1 < polls && recordTime[due + 1] <= t)
+			due++;
+		unsigned int buttons;
+		signed char axes[AXIS_COUNT];
+		inputPoll(&buttons, axes);
+		if (t >= end) { // one poll after the last, the replay must have ended
+			if (inputReplaying() || buttons == recordButtons[due])
+				failures++;
+			break;
+		}
+		if (!inputReplaying() || buttons != recordButtons[due] || memcmp(axes, recordAxes[due], AXIS_COUNT) != 0)
+			failures++;
+		(*replayed)++;
+		if (poller == 0)
+			now = start + (++k < polls ? recordTime[k] : end);
+		else
+			now += _interval(poller == 4, periods[poller], 15, &seed);
+	}
+	inputReplayStop();
+	return failures;
+}
+
+// Reads the header of a recording file; returns false if it cannot be read
+static bool _header(const char* file, inputheader_t* header) {
+	FILE* in = fopen(file, "r");
+	if (in == NULL)
+		return false;
+	bool read = fread(header, sizeof(*header), 1, in) == 1;
+	fclose(in);
+	return read;
+}
+
+// Checks that inputRecordStop leaves the file alone after a replay and reports a recording cut short by a full
+// buffer; returns the number of failed checks
+static unsigned long _checkStop(const char* file, const char* other) {
+	unsigned long failures = 0;
+	unsigned int buttons;
+	signed char axes[AXIS_COUNT];
+	inputheader_t before, after;
+	if (!_header(file, &before) || !inputReplayStart(file, loaded, sizeof(loaded)) || inputRecordStop(file) ||
+	    !_header(file, &after) || memcmp(&before, &after, sizeof(before)) != 0) {
+		printf("stopping a recording during a replay saved over %s\n", file);
+		failures++;
+	}
+	inputReplayStop();
+
+	unsigned int seed = 1;
+	now = 1000;
+	inputRecordStart(recording, 64);
+	for (int poll = 0; poll < 100; poll++, now += 20) {
+		_drive(0, now, &seed);
+		inputPoll(&buttons, axes);
+	}
+	if (inputRecording() || inputRecordStop(other)) {
+		printf("a recording cut short by a 64 byte buffer was reported as saved whole\n");
+		failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char** argv) {
+	const char* directory = argc > 1 ? argv[1] : ".";
+	unsigned long failures = 0;
+	puts("run                  polls  bytes  bytes/poll  replay    replayed polls  differing");
+	for (int run = 0; run < RUNS; run++) {
+		char file[256];
+		snprintf(file, sizeof(file), "%s/replay_roundtrip.rec", directory);
+		unsigned int length = 0, polls = _record(run, file, &length);
+		if (polls < 2) {
+			failures++;
+			continue;
+		}
+		for (int poller = 0; poller < POLLERS; poller++) {
+			unsigned long replayed = 0, differing = _replay(file, polls, poller, &replayed);
+			failures += differing;
+			printf("%-19s  %5u  %5u  %10.2f  %-8s  %14lu  %9lu\n", runs[run], polls, length, (double)length / polls,
+			       pollers[poller], replayed, differing);
+		}
+	}
+	printf("%lu replayed polls differ from the recordings\n", failures);
+	char file[256], other[256];
+	snprintf(file, sizeof(file), "%s/replay_roundtrip.rec", directory);
+	snprintf(other, sizeof(other), "%s/replay_roundtrip.cut", directory);
+	failures += _checkStop(file, other);
+	return failures ? 1 : 0;
+}
@@ -14,6 +14,11 @@
 #define _FBC_H_
 
 #include <API.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define FBC_LOOP_INTERVAL 20
 
 /**
@@ -21,6 +26,29 @@
  */
 #define FBC_STALL -1
 
+/**
+ * The largest value the internal confidence counter of a controller will count up to
+ */
+#define FBC_MAX_CONFIDENCE 0xFFFF
+
+/**
+ * The type used to store controller gains. Defining FBC_COMPACT (e.g. in EXTRA_CFLAGS) halves the size of the gains
+ * and avoids double precision math on the soft-float Cortex, at the cost of precision.
+ *
+ * FBC_COMPACT changes the layout of the controller structures, so the library must be rebuilt with the same setting
+ * as the code using it. A mismatch fails to link with an undefined reference to fbcLayoutCompact or fbcLayoutDouble
+ * instead of corrupting controllers at run time.
+ */
+#ifdef FBC_COMPACT
+typedef float fbc_gain_t;
+extern const char fbcLayoutCompact;
+static const char* const _fbcLayoutCheck __attribute__((used)) = &fbcLayoutCompact;
+#else
+typedef double fbc_gain_t;
+extern const char fbcLayoutDouble;
+static const char* const _fbcLayoutCheck __attribute__((used)) = &fbcLayoutDouble;
+#endif
+
 typedef struct fbc fbc_t; // predefine fbc_t for use inside fbc_t
  /**
   * The classical error-based closed-loop feedback controller is implemented in by fbc functions.
@@ -49,20 +77,23 @@ typedef struct fbc fbc_t; // predefine fbc_t for use inside fbc_t
    bool (*stallDetect)(fbc_t*);
 
    int goal, output;
-   int pos_deadband, neg_deadband;
-   unsigned int acceptableConfidence, acceptableTolerance;
+   // Outputs are motor PWM values and tolerances/confidences are small, so these are kept to 16 bits
+   short pos_deadband, neg_deadband;
+   unsigned short acceptableConfidence, acceptableTolerance;
    bool confident;
    bool isStalled;
 
    /*
    * FOR INTERNAL USE
    */
+   unsigned short _confidence;      // saturates at FBC_MAX_CONFIDENCE
+   unsigned short _stallDetectCount; // saturates at 0xFFFF
+   unsigned short _dt;              // milliseconds since the previous iteration, for compute functions
    void* _controllerData; // Controller data
+   struct fbc_record* _record;      // optional recorder, see fbc_record.h
 
-   unsigned int _confidence;
    unsigned long _prevExecution; // most recent time of execution
    int _prevSense;
-   unsigned int _stallDetectCount;
  } fbc_t;
 
 /**
@@ -96,15 +127,17 @@ extern bool (*fbcStallDetect)(fbc_t* fbc);
  *        A pointer to a function that returns true if the controller has stalled
  *        fbcStallDetect is available as a standard option, or you can write your own
  * @param neg_deadband
- *        The lowest possible non-zero output value for the robot to move in the negative direction
+ *        The lowest possible non-zero output value for the robot to move in the negative direction, clamped to
+ *        [-32768,32767]
  * @param pos_deadband
- *        The lowest possible non-zero output value for the robot to move in the positive direction
+ *        The lowest possible non-zero output value for the robot to move in the positive direction, clamped to
+ *        [-32768,32767]
  * @param acceptableTolerance
  *        Maximum delta between the current sensor value and the goal sensor value to be considered on target
- *        for a given time slice
+ *        for a given time slice, clamped to [0,65535]
  * @param acceptableConfidence
  *        Minimum number of contiguous time slices that need to be on target to consider the system stably
- *        on target.
+ *        on target, clamped to [0,FBC_MAX_CONFIDENCE]
  */
 void fbcInit(fbc_t* fbc, void (*move)(int), int (*sense)(void), void (*resetSense)(void), bool (*stallDetect)(fbc_t*),
              int neg_deadband, int pos_deadband, int acceptableTolerance, unsigned int acceptableConfidence);
@@ -161,6 +194,9 @@ TaskHandle fbcRunParallel(fbc_t* fbc);
 /**
  * @brief Generates the output for the feedback controller but does not actually set the output (as opposed to
  * fbcRunContinuous)
+ *
+ * @note The sensor and the clock are each sampled once per iteration so that an iteration can be replayed exactly
+ *       (see fbc_record.h)
  */
 int fbcGenerateOutput(fbc_t* fbc);
 
@@ -168,4 +204,64 @@ int fbcGenerateOutput(fbc_t* fbc);
 // time is all done in milliseconds
 #define CUR_TIME millis
 #define TIME_TO_SEC(t) ((t) / 1000)
+
+/*
+ * FOR INTERNAL USE
+ * The steps of fbcGenerateOutput and fbcStallDetect, shared with the inlined C++ controllers in fbc.hpp
+ */
+
+// Milliseconds elapsed since the previous iteration, saturated to fit fbc_t._dt
+static inline unsigned short _fbcElapsed(fbc_t* fbc, unsigned long now) {
+	unsigned long dt = now - fbc->_prevExecution;
+	return dt > 0xFFFF ? 0xFFFF : dt;
+}
+
+// Bumps the output out of the deadband and updates the controller's confidence for this iteration
+static inline int _fbcFinishOutput(fbc_t* fbc, int error, int out) {
+	if (out < fbc->pos_deadband && out > 0)
+		out = fbc->pos_deadband;
+	else if (out > fbc->neg_deadband && out < 0)
+		out = fbc->neg_deadband;
+	if ((unsigned int)abs(error) < fbc->acceptableTolerance) {
+		if (fbc->_confidence < FBC_MAX_CONFIDENCE)
+			fbc->_confidence++;
+	}
+	else
+		fbc->_confidence = 0;
+	return out;
+}
+
+// The body of fbcStallDetect given the sensor value of the current iteration
+static inline bool _fbcStallCheck(fbc_t* fbc, int sensed) {
+	unsigned int minStuck = fbc->acceptableTolerance >> 3;
+	if (minStuck < 1)
+		minStuck = 1;
+	// Below the counter's limit, so that the saturated counter still exceeds it
+	unsigned int countUntilStall = fbc->acceptableConfidence < 0xFFFF ? fbc->acceptableConfidence : 0xFFFE;
+	unsigned int delta = abs(sensed - fbc->_prevSense);
+
+	if (fbc->output == fbc->neg_deadband || fbc->output == fbc->pos_deadband || fbc->output == 0) {
+		fbc->_stallDetectCount = 0;
+		return false;
+	}
+
+	if (delta < minStuck) {
+		if (fbc->_stallDetectCount < 0xFFFF)
+			fbc->_stallDetectCount++;
+	}
+	else
+		fbc->_stallDetectCount = 0;
+
+	bool stall = fbc->_stallDetectCount > countUntilStall;
+	if (stall) {
+		fbc->_stallDetectCount = 0;
+		fbc->_prevSense = 0;
+	}
+	return stall;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* end of include guard: _FBC_H_ */
@@ -0,0 +1,207 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > C++ Controller Templates
+ * @brief Header-only C++ controllers that resolve the sensor, actuator, controller and stall detection at
+ *        compile time so that each iteration has no function pointer calls.
+ *
+ * A blrs::Controller stores a regular fbc_t as its first member with every function pointer filled in, so it can be
+ * handed to any fbc C function (fbcSetGoal, fbcRunContinuous, fbcPIDAutotuneSimple, ...) through c(). Those C
+ * functions still take the indirect path; step(), runCompletion() and runParallel() use the inlined one.
+ *
+ * Sense and Move are types providing "static int sense()" and "static void move(int)" respectively. A single type
+ * can provide both:
+ * @code
+ *		struct Arm {
+ *			static int sense() { return analogRead(1); }
+ *			static void move(int power) { motorSet(1, power); }
+ *		};
+ *
+ *		blrs::Controller<Arm, Arm, blrs::PID> arm;
+ *
+ *		void armInit() {
+ *			fbcPIDInitializeData(&arm.data, 1.0, 0.001, 100.0, -100000, 100000);
+ *			arm.init(-15, 15, 20, 5);
+ *		}
+ * @endcode
+ *
+ * @author Jonathan Bayless, Elliot Berman, Brian Hanford
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef _FBC_HPP_
+#define _FBC_HPP_
+
+#include "fbc.h"
+#include "fbc_bangbang.h"
+#include "fbc_pid.h"
+#include "fbc_record.h"
+
+namespace blrs {
+
+/**
+ * PID policy, using the same computation and data as fbcPIDInit()
+ */
+struct PID {
+	typedef fbc_pid_t Data;
+
+	static void attach(fbc_t* fbc, Data* data) {
+		fbcPIDInit(fbc, data);
+	}
+
+	static int compute(fbc_t* fbc, Data* data, int error) {
+		return fbcPIDCompute(data, error, fbc->_dt);
+	}
+};
+
+/**
+ * BangBang policy, using the same computation and data as fbcBangBangInit()
+ */
+struct BangBang {
+	typedef fbc_bangbang_t Data;
+
+	static void attach(fbc_t* fbc, Data* data) {
+		fbcBangBangInit(fbc, data);
+	}
+
+	static int compute(fbc_t* fbc, Data* data, int error) {
+		return fbcBangBangCompute(data, fbc->goal, error);
+	}
+};
+
+/**
+ * The stall detection algorithm of fbcStallDetect
+ */
+struct DefaultStall {
+	static bool (*pointer())(fbc_t*) {
+		return fbcStallDetect;
+	}
+
+	static bool detect(fbc_t* fbc, int sensed) {
+		return _fbcStallCheck(fbc, sensed);
+	}
+};
+
+/**
+ * Disables stall detection
+ */
+struct NoStall {
+	static bool (*pointer())(fbc_t*) {
+		return NULL;
+	}
+
+	static bool detect(fbc_t*, int) {
+		return false;
+	}
+};
+
+template <class Sense, class Move, class Policy, class Stall = DefaultStall> class Controller {
+public:
+	// Must remain the first member so that a Controller can be used wherever an fbc_t is
+	fbc_t fbc;
+	// The constants and state of the controller policy (fbc_pid_t or fbc_bangbang_t)
+	typename Policy::Data data;
+
+	/**
+	 * @brief Initializes the controller. data must be initialized first (e.g. with fbcPIDInitializeData).
+	 *        The parameters are the same as those of fbcInit().
+	 */
+	void init(int neg_deadband, int pos_deadband, int acceptableTolerance, unsigned int acceptableConfidence) {
+		fbcInit(&fbc, &_move, &_sense, NULL, Stall::pointer(), neg_deadband, pos_deadband, acceptableTolerance,
+		        acceptableConfidence);
+		Policy::attach(&fbc, &data);
+	}
+
+	/**
+	 * @returns the underlying fbc_t for use with the fbc C functions
+	 */
+	fbc_t* c() {
+		return &fbc;
+	}
+
+	bool setGoal(int goal) {
+		return fbcSetGoal(&fbc, goal);
+	}
+
+	int isConfident() {
+		return fbcIsConfident(&fbc);
+	}
+
+	/**
+	 * @brief The inlined equivalent of fbcGenerateOutput()
+	 */
+	int generateOutput() {
+		unsigned long now = CUR_TIME();
+		int sensed = Sense::sense();
+		int error = fbc.goal - sensed;
+		fbc._dt = _fbcElapsed(&fbc, now);
+		int out = _fbcFinishOutput(&fbc, error, Policy::compute(&fbc, &data, error));
+		fbc.isStalled = Stall::detect(&fbc, sensed);
+		fbc._prevSense = sensed;
+		fbc._prevExecution = now;
+		fbc.output = out;
+		if (fbc._record)
+			fbcRecordEvent(&fbc, FBC_RECORD_ITERATION, now, sensed, out);
+		return out;
+	}
+
+	/**
+	 * @brief The inlined equivalent of fbcRunContinuous()
+	 *
+	 * @returns 1 if confident, FBC_STALL (-1) if stalled, and 0 otherwise
+	 */
+	int step() {
+		Move::move(generateOutput());
+		return fbcIsConfident(&fbc);
+	}
+
+	/**
+	 * @brief Runs the controller in this task until it is stably on target or stalled
+	 *
+	 * @param timeout
+	 *        Number of milliseconds that the controller will be allowed to run. Setting to 0 will disable timeout
+	 *
+	 * @returns true if the movement timed out, false otherwise
+	 */
+	bool runCompletion(unsigned long timeout) {
+		unsigned long now = millis();
+		unsigned long start = now;
+		while (!step()) {
+			if (timeout != 0 && now - start >= timeout)
+				return true;
+			taskDelayUntil(&now, FBC_LOOP_INTERVAL);
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Spawns a new task running step() every FBC_LOOP_INTERVAL
+	 */
+	TaskHandle runParallel() {
+		return taskCreate(&_task, TASK_DEFAULT_STACK_SIZE, this, TASK_PRIORITY_DEFAULT);
+	}
+
+private:
+	static int _sense() {
+		return Sense::sense();
+	}
+
+	static void _move(int out) {
+		Move::move(out);
+	}
+
+	static void _task(void* param) {
+		Controller* controller = (Controller*)param;
+		unsigned long now = millis();
+		while (true) {
+			controller->step();
+			taskDelayUntil(&now, FBC_LOOP_INTERVAL);
+		}
+	}
+};
+
+} // namespace blrs
+
+#endif /* end of include guard: _FBC_HPP_ */
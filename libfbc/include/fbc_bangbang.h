@@ -20,13 +20,17 @@
 
 #include "fbc.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Struct containing necessary data for the BangBang controller to function,
  * include the various constants necessary
  */
 typedef struct fbc_bangbang {
 	// The braking constant for when the system has passed its goal
-	double kBrake;
+	fbc_gain_t kBrake;
 	// Normal output speed when not at goal
 	int fullSpeed;
 
@@ -57,4 +61,33 @@ void fbcBangBangInitializeData(fbc_bangbang_t* bangbang, double kBrake, int full
  */
 void fbcBangBangInit(fbc_t* fbc, fbc_bangbang_t* config);
 
+/**
+ * @brief Computes one BangBang iteration. This is the compute function installed by fbcBangBangInit(), exposed so
+ *        that it can be inlined by the C++ controllers in fbc.hpp.
+ *
+ * @param data
+ *        The BangBang constants and state
+ * @param goal
+ *        The goal of the controller
+ * @param error
+ *        The difference between the goal and the sensor value
+ *
+ * @returns the controller output
+ */
+static inline int fbcBangBangCompute(fbc_bangbang_t* data, int goal, int error) {
+	int errorSign = (error > 0) - (error < 0);
+	int goalSign = (goal > 0) - (goal < 0);
+	if (errorSign != goalSign)
+		data->_passed = true;
+
+	if (data->_passed)
+		return (data->kBrake * error);
+	else
+		return (goalSign * data->fullSpeed);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* end of include guard: _FBC_BANGBANG_H_ */
@@ -15,17 +15,21 @@
 
 #include "fbc.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Struct containing necessary data for the PID controller to function,
  * include the various constants necessary
  */
 typedef struct fbc_pid {
 	// The proprtional constant
-	double kP;
+	fbc_gain_t kP;
 	// The integral constant
-	double kI;
+	fbc_gain_t kI;
 	// The derivative constant
-	double kD;
+	fbc_gain_t kD;
 	// Minimum value the integral can take. This limits the effect of the integral
 	int minI;
 	// Maximum value the integral can take.
@@ -39,4 +43,33 @@ void fbcPIDInitializeData(fbc_pid_t* fbc_pid, double kP, double kI, double kD, i
 
 void fbcPIDInit(fbc_t* fbc, fbc_pid_t* config);
 
+/**
+ * @brief Computes one PID iteration. This is the compute function installed by fbcPIDInit(), exposed so that it
+ *        can be inlined by the C++ controllers in fbc.hpp.
+ *
+ * @param data
+ *        The PID constants and state
+ * @param error
+ *        The difference between the goal and the sensor value
+ * @param dt
+ *        Milliseconds since the previous iteration (fbc_t._dt). When it is 0, e.g. for the first iteration in the same
+ *        millisecond as fbcSetGoal(), the derivative term is left out.
+ *
+ * @returns the controller output
+ */
+static inline int fbcPIDCompute(fbc_pid_t* data, int error, unsigned long dt) {
+	data->_integral += error;
+	if (data->_integral < data->minI)
+		data->_integral = data->minI;
+	else if (data->_integral > data->maxI)
+		data->_integral = data->maxI;
+	fbc_gain_t derivative = dt ? ((fbc_gain_t)(error - data->_prevError) / dt) : 0; // 0 / 0 would be NaN
+	data->_prevError = error;
+	return (data->kP * error) + (data->kI * data->_integral) + (data->kD * derivative);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* end of include guard: _FBC_PID_H_ */
@@ -0,0 +1,76 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > Controller Pool
+ * @brief A statically sized pool of controllers and their controller data, for builds that cannot afford (or do not
+ *        want) heap allocation or many global controllers.
+ *
+ * Each pool slot holds one fbc_t and storage for its PID or BangBang data, so a pooled controller costs exactly one
+ * slot. Slots are reserved by fbcPoolAlloc() and returned by fbcPoolFree().
+ *
+ * Example:
+ * @code
+ *		fbc_t* arm = fbcPoolAlloc();
+ *		fbcInit(arm, armMove, armSense, NULL, fbcStallDetect, -15, 15, 20, 5);
+ *		fbcPIDInitializeData(fbcPoolPIDData(arm), 1.0, 0.001, 100.0, -100000, 100000);
+ *		fbcPIDInit(arm, fbcPoolPIDData(arm));
+ * @endcode
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef _FBC_POOL_H_
+#define _FBC_POOL_H_
+
+#include "fbc.h"
+#include "fbc_bangbang.h"
+#include "fbc_pid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of controllers in the pool (at most 32). The library must be rebuilt for a change to take effect.
+ */
+#ifndef FBC_POOL_SIZE
+#define FBC_POOL_SIZE 4
+#endif
+#if FBC_POOL_SIZE > 32
+#error FBC_POOL_SIZE must be at most 32, one bit of the reserved slot mask each
+#endif
+
+/**
+ * @brief Reserves a controller from the pool. Not safe to call from several tasks at once; reserve controllers
+ *        in initialize().
+ *
+ * @returns a zeroed controller, or NULL if every slot is in use
+ */
+fbc_t* fbcPoolAlloc();
+
+/**
+ * @brief Returns a controller reserved with fbcPoolAlloc() to the pool
+ */
+void fbcPoolFree(fbc_t* fbc);
+
+/**
+ * @returns the PID data storage paired with a pooled controller
+ */
+fbc_pid_t* fbcPoolPIDData(fbc_t* fbc);
+
+/**
+ * @returns the BangBang data storage paired with a pooled controller
+ */
+fbc_bangbang_t* fbcPoolBangBangData(fbc_t* fbc);
+
+/**
+ * @brief Prints the RAM used by each libfbc feature and the current pool usage to the terminal
+ */
+void fbcPrintMemoryReport();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: _FBC_POOL_H_ */
@@ -0,0 +1,118 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > Record and Replay
+ * @brief Records the inputs of every controller iteration so that a run can be reproduced off the robot
+ *
+ * While a recorder is attached, every fbcSetGoal() and every iteration (sensor value, time and output) is written
+ * to a ring buffer. fbcRecordSave() writes the buffer to the PROS flash filesystem, and the host tool in
+ * tools/fbc_replay.c feeds it back through the same compute functions to reproduce the outputs exactly, or to
+ * compare them against new gains.
+ *
+ * Replay starts from the oldest goal change in the buffer, since that resets all controller state. Make the buffer
+ * large enough to hold the movement of interest.
+ *
+ * Example:
+ * @code
+ *		static fbc_record_entry_t armLog[500];
+ *		static fbc_record_t armRecord;
+ *		...
+ *		fbcRecordInit(&armRecord, armLog, 500);
+ *		fbcRecordAttach(&arm, &armRecord);
+ *		...
+ *		fbcRecordSave(&arm, "armlog");
+ * @endcode
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef _FBC_RECORD_H_
+#define _FBC_RECORD_H_
+
+#include "fbc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Identifies a saved recording and its layout
+#define FBC_RECORD_MAGIC 0x52434246 // "FBCR"
+#define FBC_RECORD_VERSION 2
+
+// Entry types
+#define FBC_RECORD_ITERATION 0 // value is the sensor reading, output is the controller output
+#define FBC_RECORD_GOAL 1      // value is the new goal
+
+/**
+ * One recorded event. Fixed-size types keep the layout identical on the robot and the host.
+ */
+typedef struct fbc_record_entry {
+	uint32_t time; // CUR_TIME() of the event
+	int32_t value;
+	int32_t output; // full range, since compute functions do not clamp their output
+	uint8_t type;
+	uint8_t _reserved[3];
+} fbc_record_entry_t;
+
+/**
+ * Header of a saved recording, followed by count entries from oldest to newest
+ */
+typedef struct fbc_record_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t _reserved;
+	uint32_t count;
+	int16_t neg_deadband, pos_deadband;
+	uint16_t acceptableTolerance, acceptableConfidence;
+} fbc_record_header_t;
+
+typedef struct fbc_record {
+	fbc_record_entry_t* entries;
+	unsigned int size;
+
+	/*
+	 * FOR INTERNAL USE
+	 */
+	unsigned int _written; // total number of entries written, the ring index is _written % size
+} fbc_record_t;
+
+/**
+ * @brief Initializes a recorder with a caller-provided buffer
+ *
+ * @param record
+ *        The recorder to initialize
+ * @param buffer
+ *        Storage for size entries (16 bytes each)
+ * @param size
+ *        Number of entries the ring can hold before the oldest are overwritten
+ */
+void fbcRecordInit(fbc_record_t* record, fbc_record_entry_t* buffer, unsigned int size);
+
+/**
+ * @brief Starts recording a controller. Passing NULL stops recording.
+ */
+void fbcRecordAttach(fbc_t* fbc, fbc_record_t* record);
+
+/**
+ * @brief Writes the recording of a controller to a file on the PROS flash filesystem
+ *
+ * @param fbc
+ *        A controller with a recorder attached
+ * @param file
+ *        The file name to write to
+ *
+ * @returns true if the recording was written
+ */
+bool fbcRecordSave(fbc_t* fbc, const char* file);
+
+/**
+ * @brief Adds an entry to the recorder of a controller. Called by fbcGenerateOutput() and fbcSetGoal().
+ */
+void fbcRecordEvent(fbc_t* fbc, unsigned char type, unsigned long time, int value, int output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: _FBC_RECORD_H_ */
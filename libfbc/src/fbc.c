@@ -11,6 +11,7 @@
  */
 
 #include "fbc.h"
+#include "fbc_record.h"
 
 static void _fbcTask(void* param) {
 	fbc_t* fbc = (fbc_t*)param;
@@ -22,43 +23,35 @@ static void _fbcTask(void* param) {
 }
 
 static bool _fbcStallDetect(fbc_t* fbc) {
-	unsigned int minStuck = fbc->acceptableTolerance >> 3;
-	if (minStuck < 1)
-		minStuck = 1;
-	unsigned int countUntilStall = fbc->acceptableConfidence;
-	unsigned int delta = abs(fbc->sense() - fbc->_prevSense);
+	return _fbcStallCheck(fbc, fbc->sense());
+}
 
-	if (fbc->output == fbc->neg_deadband || fbc->output == fbc->pos_deadband || fbc->output == 0) {
-		fbc->_stallDetectCount = 0;
-		return false;
-	}
+bool (*fbcStallDetect)(fbc_t* fbc) = _fbcStallDetect;
 
-	if (delta < minStuck)
-		fbc->_stallDetectCount++;
-	else
-		fbc->_stallDetectCount = 0;
+// Defines the symbol fbc.h references for the FBC_COMPACT setting this library was built with
+#ifdef FBC_COMPACT
+const char fbcLayoutCompact = 1;
+#else
+const char fbcLayoutDouble = 1;
+#endif
 
-	bool stall = fbc->_stallDetectCount > countUntilStall;
-	if (stall) {
-		fbc->_stallDetectCount = 0;
-		fbc->_prevSense = 0;
-	}
-	return stall;
+static int _fbcClamp(int value, int min, int max) {
+	return value < min ? min : (value > max ? max : value);
 }
 
-bool (*fbcStallDetect)(fbc_t* fbc) = _fbcStallDetect;
-
 void fbcInit(fbc_t* fbc, void (*move)(int), int (*sense)(void), void (*resetSense)(void), bool (*stallDetect)(fbc_t*),
              int neg_deadband, int pos_deadband, int acceptableTolerance, unsigned int acceptableConfidence) {
 	fbc->move = move;
 	fbc->sense = sense;
 	fbc->resetSense = resetSense;
 	fbc->stallDetect = stallDetect;
-	fbc->acceptableTolerance = acceptableTolerance;
-	fbc->acceptableConfidence = acceptableConfidence;
-	fbc->neg_deadband = neg_deadband;
-	fbc->pos_deadband = pos_deadband;
+	// These are stored in 16 bits, so clamp them rather than let them wrap around
+	fbc->acceptableTolerance = _fbcClamp(acceptableTolerance, 0, 0xFFFF);
+	fbc->acceptableConfidence = acceptableConfidence > FBC_MAX_CONFIDENCE ? FBC_MAX_CONFIDENCE : acceptableConfidence;
+	fbc->neg_deadband = _fbcClamp(neg_deadband, -32768, 32767);
+	fbc->pos_deadband = _fbcClamp(pos_deadband, -32768, 32767);
 	fbc->resetController = NULL;
+	fbc->_record = NULL;
 	fbcReset(fbc);
 }
 
@@ -77,6 +70,8 @@ bool fbcSetGoal(fbc_t* fbc, int new_goal) {
 	fbcReset(fbc);
 	fbc->goal = new_goal;
 	fbc->_prevExecution = CUR_TIME();
+	if (fbc->_record)
+		fbcRecordEvent(fbc, FBC_RECORD_GOAL, fbc->_prevExecution, new_goal, 0);
 	return true;
 }
 
@@ -102,22 +97,19 @@ TaskHandle fbcRunParallel(fbc_t* fbc) {
 }
 
 int fbcGenerateOutput(fbc_t* fbc) {
-	int error = fbc->goal - fbc->sense();
-	int out = fbc->compute(fbc, error);
-	if (out < fbc->pos_deadband && out > 0)
-		out = fbc->pos_deadband;
-	else if (out > fbc->neg_deadband && out < 0)
-		out = fbc->neg_deadband;
-	if ((unsigned int)abs(error) < fbc->acceptableTolerance)
-		fbc->_confidence++;
-	else
-		fbc->_confidence = 0;
+	unsigned long now = CUR_TIME();
+	int sensed = fbc->sense();
+	int error = fbc->goal - sensed;
+	fbc->_dt = _fbcElapsed(fbc, now);
+	int out = _fbcFinishOutput(fbc, error, fbc->compute(fbc, error));
 
 	if(fbc->stallDetect != NULL)
 		fbc->isStalled = fbc->stallDetect(fbc);
-	fbc->_prevSense = fbc->sense();
-	fbc->_prevExecution = CUR_TIME();
+	fbc->_prevSense = sensed;
+	fbc->_prevExecution = now;
 	fbc->output = out;
+	if (fbc->_record)
+		fbcRecordEvent(fbc, FBC_RECORD_ITERATION, now, sensed, out);
 	return out;
 }
 
@@ -5,15 +5,7 @@ __attribute__((weak)) int sgn(int in) {
 }
 
 static int _bangbangCompute(fbc_t* fbc, int error) {
-	fbc_bangbang_t* data = (fbc_bangbang_t*)(fbc->_controllerData);
-
-	if (sgn(error) != sgn(fbc->goal))
-		data->_passed = true;
-
-	if (data->_passed)
-		return (data->kBrake * error);
-	else
-		return (sgn(fbc->goal) * data->fullSpeed);
+	return fbcBangBangCompute((fbc_bangbang_t*)(fbc->_controllerData), fbc->goal, error);
 }
 
 static void _bangbangReset(fbc_t* fbc) {
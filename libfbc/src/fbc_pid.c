@@ -13,16 +13,7 @@
 #include "fbc_pid.h"
 
 static int _pidCompute(fbc_t* fbc, int error) {
-	fbc_pid_t* data = (fbc_pid_t*)(fbc->_controllerData);
-
-	data->_integral += error;
-	if (data->_integral < data->minI)
-		data->_integral = data->minI;
-	else if (data->_integral > data->maxI)
-		data->_integral = data->maxI;
-	double derivative = ((double)(error - data->_prevError) / (CUR_TIME() - fbc->_prevExecution));
-	data->_prevError = error;
-	return (data->kP * error) + (data->kI * data->_integral) + (data->kD * derivative);
+	return fbcPIDCompute((fbc_pid_t*)(fbc->_controllerData), error, fbc->_dt);
 }
 
 static void _pidReset(fbc_t* fbc) {
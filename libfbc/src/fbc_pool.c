@@ -0,0 +1,71 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > Controller Pool
+ * @brief A statically sized pool of controllers and their controller data
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "fbc_pool.h"
+#include <string.h>
+
+typedef struct pool_slot {
+	fbc_t fbc; // must be first so that a pooled fbc_t* is also a pool_slot_t*
+	union {
+		fbc_pid_t pid;
+		fbc_bangbang_t bangbang;
+	} data;
+} pool_slot_t;
+
+static pool_slot_t pool[FBC_POOL_SIZE];
+static unsigned int used; // bit i is set when pool[i] is reserved
+
+static pool_slot_t* _slotOf(fbc_t* fbc) {
+	pool_slot_t* slot = (pool_slot_t*)fbc;
+	if (slot < pool || slot >= pool + FBC_POOL_SIZE)
+		return NULL;
+	return slot;
+}
+
+fbc_t* fbcPoolAlloc() {
+	for (int i = 0; i < FBC_POOL_SIZE; i++) {
+		if (!(used & (1U << i))) {
+			used |= 1U << i;
+			memset(&pool[i], 0, sizeof(pool_slot_t));
+			return &pool[i].fbc;
+		}
+	}
+	return NULL;
+}
+
+void fbcPoolFree(fbc_t* fbc) {
+	pool_slot_t* slot = _slotOf(fbc);
+	if (slot)
+		used &= ~(1U << (slot - pool));
+}
+
+fbc_pid_t* fbcPoolPIDData(fbc_t* fbc) {
+	pool_slot_t* slot = _slotOf(fbc);
+	return slot ? &slot->data.pid : NULL;
+}
+
+fbc_bangbang_t* fbcPoolBangBangData(fbc_t* fbc) {
+	pool_slot_t* slot = _slotOf(fbc);
+	return slot ? &slot->data.bangbang : NULL;
+}
+
+void fbcPrintMemoryReport() {
+	unsigned int inUse = 0;
+	for (int i = 0; i < FBC_POOL_SIZE; i++)
+		if (used & (1U << i))
+			inUse++;
+
+	printf("libfbc RAM usage (bytes)\n");
+	printf("  controller (fbc_t):         %u each\n", (unsigned int)sizeof(fbc_t));
+	printf("  PID data (fbc_pid_t):       %u each\n", (unsigned int)sizeof(fbc_pid_t));
+	printf("  BangBang data:              %u each\n", (unsigned int)sizeof(fbc_bangbang_t));
+	printf("  pool:                       %u (%u/%u slots in use)\n", (unsigned int)sizeof(pool), inUse, FBC_POOL_SIZE);
+	printf("  autotune:                   heap, only while fbcPIDAutotune* runs\n");
+}
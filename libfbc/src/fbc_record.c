@@ -0,0 +1,60 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > Record and Replay
+ * @brief Records the inputs of every controller iteration so that a run can be reproduced off the robot
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "fbc_record.h"
+
+void fbcRecordInit(fbc_record_t* record, fbc_record_entry_t* buffer, unsigned int size) {
+	record->entries = buffer;
+	record->size = size;
+	record->_written = 0;
+}
+
+void fbcRecordAttach(fbc_t* fbc, fbc_record_t* record) {
+	fbc->_record = record;
+}
+
+void fbcRecordEvent(fbc_t* fbc, unsigned char type, unsigned long time, int value, int output) {
+	fbc_record_t* record = fbc->_record;
+	if (record == NULL || record->size == 0)
+		return;
+	fbc_record_entry_t* entry = &record->entries[record->_written % record->size];
+	entry->time = time;
+	entry->value = value;
+	entry->output = output;
+	entry->type = type;
+	entry->_reserved[0] = entry->_reserved[1] = entry->_reserved[2] = 0;
+	record->_written++;
+}
+
+bool fbcRecordSave(fbc_t* fbc, const char* file) {
+	fbc_record_t* record = fbc->_record;
+	if (record == NULL)
+		return false;
+
+	unsigned int count = record->_written < record->size ? record->_written : record->size;
+	unsigned int first = record->_written - count;
+	fbc_record_header_t header = {FBC_RECORD_MAGIC,
+	                              FBC_RECORD_VERSION,
+	                              0,
+	                              count,
+	                              fbc->neg_deadband,
+	                              fbc->pos_deadband,
+	                              fbc->acceptableTolerance,
+	                              fbc->acceptableConfidence};
+
+	FILE* out = fopen(file, "w");
+	if (out == NULL)
+		return false;
+	fwrite(&header, sizeof(header), 1, out);
+	for (unsigned int i = first; i < record->_written; i++)
+		fwrite(&record->entries[i % record->size], sizeof(fbc_record_entry_t), 1, out);
+	fclose(out);
+	return true;
+}
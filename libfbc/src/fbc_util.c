@@ -14,9 +14,6 @@ typedef struct set {
 	double best_err;
 } set_t;
 
-// Declared at the file scope to prevent a stack overflow
-static set_t p[MAX_PARTICLES];
-
 // Returns a random double between 0 and 1
 static inline double rand_num() {
 	return (rand() / (double)RAND_MAX);
@@ -35,6 +32,12 @@ void fbcPIDAutotuneFull(fbc_t* fbc, int num_iterations, int num_particles, int t
 		puts("ERROR: can't have more than 30 particles");
 		return;
 	}
+	// The swarm is too large for a task stack and is only needed while tuning, so it lives on the heap
+	set_t* p = (set_t*)malloc(num_particles * sizeof(set_t));
+	if (p == NULL) {
+		puts("ERROR: not enough memory for the particles");
+		return;
+	}
 	set_t p_global;
 
 	// Initialize the particles
@@ -55,7 +58,9 @@ void fbcPIDAutotuneFull(fbc_t* fbc, int num_iterations, int num_particles, int t
 	p_global.kI.best = 0;
 	p_global.kD.best = 0;
 
-	fbc->acceptableConfidence *= 2; // double the confidence for extra accuracy
+	// double the confidence for extra accuracy
+	fbc->acceptableConfidence = fbc->acceptableConfidence < FBC_MAX_CONFIDENCE / 2 ? fbc->acceptableConfidence * 2
+	                                                                              : FBC_MAX_CONFIDENCE;
 
 	// Run the optimization
 	for (int j = 0; j < num_iterations; j++) {
@@ -133,6 +138,7 @@ void fbcPIDAutotuneFull(fbc_t* fbc, int num_iterations, int num_particles, int t
 	}
 
 	fbc->move(0); // stop the motors, keeps it from running off when using the killswitch
+	free(p);
 	printf("\n\nFinal Constants: \n");
 	printf("kP: %lf\n", p_global.kP.best);
 	printf("kI: %lf\n", p_global.kI.best);
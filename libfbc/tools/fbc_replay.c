@@ -0,0 +1,134 @@
+/**
+ * @file Team BLRS Feedback Controller Library (FBC Library)
+ *       > Host Replay Tool
+ * @brief Replays a recording made with fbc_record.h through the libfbc compute functions on a computer
+ *
+ * Every recorded iteration is fed back through fbcGenerateOutput() with the recorded sensor value and time. With the
+ * gains used on the robot the outputs match the recording exactly; with new gains (or changed controller code) the
+ * differing iterations are listed, which turns a recorded match into a regression test.
+ *
+ * Build from the libfbc directory with the same FBC_COMPACT setting as the robot code:
+ *		gcc -std=gnu99 -Iinclude -o fbc_replay tools/fbc_replay.c src/fbc.c src/fbc_pid.c src/fbc_bangbang.c \
+ *		    src/fbc_record.c
+ *
+ * Usage:
+ *		fbc_replay <recording> pid <kP> <kI> <kD> <minI> <maxI> [-v]
+ *		fbc_replay <recording> bangbang <kBrake> <fullSpeed> [-v]
+ *
+ * -v prints every iteration instead of only the differing ones. The exit status is 1 if any output differs.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "fbc.h"
+#include "fbc_bangbang.h"
+#include "fbc_pid.h"
+#include "fbc_record.h"
+#include <string.h>
+
+// The replayed sensor value and clock
+static int replaySense;
+static unsigned long replayTime;
+
+// Stand-ins for the PROS functions used by libfbc
+unsigned long millis() {
+	return replayTime;
+}
+
+void taskDelayUntil(unsigned long* previousWakeTime, const unsigned long cycleTime) {
+	*previousWakeTime += cycleTime;
+}
+
+TaskHandle taskCreate(TaskCode taskCode, const unsigned int stackDepth, void* parameters,
+                      const unsigned int priority) {
+	return NULL;
+}
+
+static int _replaySense() {
+	return replaySense;
+}
+
+static void _replayMove(int out) {
+}
+
+static int _usage() {
+	puts("usage: fbc_replay <recording> pid <kP> <kI> <kD> <minI> <maxI> [-v]");
+	puts("       fbc_replay <recording> bangbang <kBrake> <fullSpeed> [-v]");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3)
+		return _usage();
+	bool verbose = strcmp(argv[argc - 1], "-v") == 0;
+	if (verbose)
+		argc--;
+
+	FILE* in = fopen(argv[1], "rb");
+	if (in == NULL) {
+		printf("could not open %s\n", argv[1]);
+		return 2;
+	}
+	fbc_record_header_t header;
+	if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != FBC_RECORD_MAGIC ||
+	    header.version != FBC_RECORD_VERSION) {
+		printf("%s is not an fbc recording\n", argv[1]);
+		return 2;
+	}
+	fbc_record_entry_t* entries = (fbc_record_entry_t*)malloc(header.count * sizeof(fbc_record_entry_t));
+	unsigned int count = fread(entries, sizeof(fbc_record_entry_t), header.count, in);
+	fclose(in);
+
+	fbc_t fbc;
+	fbc_pid_t pid;
+	fbc_bangbang_t bangbang;
+	memset(&fbc, 0, sizeof(fbc));
+	fbcInit(&fbc, _replayMove, _replaySense, NULL, NULL, header.neg_deadband, header.pos_deadband,
+	        header.acceptableTolerance, header.acceptableConfidence);
+	if (strcmp(argv[2], "pid") == 0 && argc == 8) {
+		fbcPIDInitializeData(&pid, atof(argv[3]), atof(argv[4]), atof(argv[5]), atoi(argv[6]), atoi(argv[7]));
+		fbcPIDInit(&fbc, &pid);
+	}
+	else if (strcmp(argv[2], "bangbang") == 0 && argc == 5) {
+		fbcBangBangInitializeData(&bangbang, atof(argv[3]), atoi(argv[4]));
+		fbcBangBangInit(&fbc, &bangbang);
+	}
+	else
+		return _usage();
+
+	// Controller state is only known from a goal change onwards
+	unsigned int i = 0;
+	while (i < count && entries[i].type != FBC_RECORD_GOAL)
+		i++;
+	if (i == count) {
+		puts("the recording does not contain a goal change to start replaying from");
+		return 2;
+	}
+
+	unsigned int iterations = 0, differences = 0;
+	for (; i < count; i++) {
+		fbc_record_entry_t* entry = &entries[i];
+		replayTime = entry->time;
+		if (entry->type == FBC_RECORD_GOAL) {
+			fbcSetGoal(&fbc, entry->value);
+			if (verbose)
+				printf("%10u goal %d\n", entry->time, entry->value);
+			continue;
+		}
+
+		replaySense = entry->value;
+		int out = fbcGenerateOutput(&fbc);
+		iterations++;
+		if (out != entry->output)
+			differences++;
+		if (verbose || out != entry->output)
+			printf("%10u sense %6d recorded %4d replayed %4d%s\n", entry->time, entry->value, entry->output, out,
+			       out != entry->output ? " <" : "");
+	}
+
+	printf("%u iterations replayed, %u outputs differ\n", iterations, differences);
+	free(entries);
+	return differences ? 1 : 0;
+}
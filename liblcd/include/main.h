@@ -46,6 +46,7 @@
 #include <API.h>
 
 #include "lcd.h"
+#include "routine.h"
 
 // Allow usage of this file in C++ programs
 #ifdef __cplusplus
@@ -0,0 +1,162 @@
+/**
+ * @file libLCD > Autonomous Routines
+ * @brief Stackless cooperative routines so that several autonomous actions can overlap on a single task
+ *
+ * A routine is a function that is re-entered every step and resumes from the last ROUTINE_AWAIT_* it was
+ * blocked on (protothread-style). Because routines share the stack of the task running them, local variables
+ * are NOT preserved across an await; keep any state that must survive in static variables or in the routine's
+ * arg. Only one await may appear on a given source line.
+ *
+ * Example:
+ * @code
+ *		int driveRoutine(routine_t* rt) {
+ *			ROUTINE_BEGIN(rt);
+ *			chassisSet(127, 127);
+ *			ROUTINE_AWAIT_TIME(rt, 3500);
+ *			chassisSet(0, 0);
+ *			ROUTINE_END(rt);
+ *		}
+ * @endcode
+ */
+#ifndef _ROUTINE_H_
+#define _ROUTINE_H_
+
+#include <API.h>
+
+/**
+ * Values returned by a routine body and by routineStep()
+ */
+#define ROUTINE_WAITING 0
+#define ROUTINE_DONE 1
+
+typedef struct routine routine_t; // predefine routine_t for use inside routine_t
+
+typedef struct routine {
+	// The body of the routine. Written with the ROUTINE_* macros below
+	int (*body)(routine_t*);
+	// User data passed along to the routine (e.g. a controller or a script parameter)
+	void* arg;
+	// Name used when printing the step report
+	const char* name;
+
+	/*
+	 * FOR INTERNAL USE
+	 */
+	unsigned int _line;     // source line to resume from, 0 when the routine has not started
+	bool _done;             // set once ROUTINE_END has been reached
+	unsigned long _now;     // time (msec) of the step in progress
+	unsigned long _wake;    // time (msec) that ROUTINE_AWAIT_TIME is waiting for
+	unsigned long _steps;   // number of times the routine has been stepped
+	unsigned long _lastUs;  // duration of the most recent step in microseconds
+	unsigned long _maxUs;   // longest step in microseconds
+	unsigned long _totalUs; // sum of all step durations in microseconds
+} routine_t;
+
+/**
+ * Starts the body of a routine. Must be the first statement in the routine function.
+ */
+#define ROUTINE_BEGIN(rt)                                                                                              \
+	switch ((rt)->_line) {                                                                                               \
+	case 0:
+
+/**
+ * Ends the body of a routine. Must be the last statement in the routine function.
+ */
+#define ROUTINE_END(rt)                                                                                                \
+	}                                                                                                                    \
+	(rt)->_done = true;                                                                                                  \
+	return ROUTINE_DONE
+
+/**
+ * Suspends the routine until cond evaluates to true. cond is re-evaluated once per step.
+ */
+#define ROUTINE_AWAIT_UNTIL(rt, cond)                                                                                  \
+	do {                                                                                                                 \
+		(rt)->_line = __LINE__;                                                                                            \
+	case __LINE__:                                                                                                       \
+		if (!(cond))                                                                                                       \
+			return ROUTINE_WAITING;                                                                                          \
+	} while (0)
+
+/**
+ * Gives up the rest of this step; the routine resumes at the next step.
+ */
+#define ROUTINE_YIELD(rt)                                                                                              \
+	do {                                                                                                                 \
+		(rt)->_line = __LINE__;                                                                                            \
+		return ROUTINE_WAITING;                                                                                            \
+	case __LINE__:;                                                                                                      \
+	} while (0)
+
+/**
+ * Suspends the routine for ms milliseconds. This is the non-blocking replacement for delay().
+ */
+#define ROUTINE_AWAIT_TIME(rt, ms)                                                                                     \
+	do {                                                                                                                 \
+		(rt)->_wake = (rt)->_now + (ms);                                                                                   \
+		ROUTINE_AWAIT_UNTIL(rt, (long)((rt)->_now - (rt)->_wake) >= 0);                                                    \
+	} while (0)
+
+/**
+ * Suspends the routine until the value of the sensor expression (e.g. analogRead(1)) is within [lo, hi].
+ */
+#define ROUTINE_AWAIT_SENSOR(rt, sense, lo, hi) ROUTINE_AWAIT_UNTIL(rt, routineInRange((sense), (lo), (hi)))
+
+/**
+ * Runs one iteration of a libfbc feedback controller per step until it is confident or stalled.
+ * Requires fbc.h to be included by the file defining the routine.
+ */
+#define ROUTINE_AWAIT_CONTROLLER(rt, fbc) ROUTINE_AWAIT_UNTIL(rt, fbcRunContinuous(fbc) != 0)
+
+/**
+ * Suspends the routine until another routine has finished.
+ */
+#define ROUTINE_AWAIT_ROUTINE(rt, other) ROUTINE_AWAIT_UNTIL(rt, (other)->_done)
+
+/**
+ * @brief Used by ROUTINE_AWAIT_SENSOR so that the sensor is only read once per step
+ */
+static inline bool routineInRange(int value, int lo, int hi) {
+	return value >= lo && value <= hi;
+}
+
+/**
+ * @brief Prepares a routine to be run from its beginning.
+ *
+ * @param rt
+ *        The routine to initialize
+ * @param body
+ *        The routine function, written using ROUTINE_BEGIN and ROUTINE_END
+ * @param arg
+ *        User data available to the routine as rt->arg
+ * @param name
+ *        A name used by routinePrintReport()
+ */
+void routineInit(routine_t* rt, int (*body)(routine_t*), void* arg, const char* name);
+
+/**
+ * @brief Runs the routine until its next await and records how long the step took.
+ *
+ * @returns ROUTINE_DONE if the routine has finished, ROUTINE_WAITING otherwise
+ */
+int routineStep(routine_t* rt);
+
+/**
+ * @brief Steps every routine once per period in the calling task until all of them have finished.
+ *        This is the only task needed to run any number of concurrent routines.
+ *
+ * @param routines
+ *        An array of initialized routines
+ * @param count
+ *        The number of routines in the array
+ * @param period
+ *        The time between steps in milliseconds
+ */
+void routineRunAll(routine_t* routines, unsigned int count, unsigned long period);
+
+/**
+ * @brief Prints the number of steps and the average and worst-case CPU time per step of each routine.
+ */
+void routinePrintReport(routine_t* routines, unsigned int count);
+
+#endif
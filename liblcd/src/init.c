@@ -40,8 +40,32 @@ void exampleScript1() {
   return;
 }
 
+// Example routines that run at the same time on the autonomous task
+static int exampleBlink(routine_t* rt) {
+  static int blink; // locals are not kept across awaits, so the loop counter is static
+  ROUTINE_BEGIN(rt);
+  for (blink = 0; blink < 5; blink++) {
+    digitalWrite(1, LOW);
+    ROUTINE_AWAIT_TIME(rt, 250);
+    digitalWrite(1, HIGH);
+    ROUTINE_AWAIT_TIME(rt, 250);
+  }
+  ROUTINE_END(rt);
+}
+
+static int exampleWaitForSensor(routine_t* rt) {
+  ROUTINE_BEGIN(rt);
+  ROUTINE_AWAIT_SENSOR(rt, analogRead(1), 2048, 4095);
+  lcdPrintCentered(2, "Sensor reached");
+  ROUTINE_END(rt);
+}
+
 void exampleScript2() {
-  return;
+  routine_t routines[2];
+  routineInit(&routines[0], exampleBlink, NULL, "blink");
+  routineInit(&routines[1], exampleWaitForSensor, NULL, "sensor");
+  routineRunAll(routines, 2, 20);
+  routinePrintReport(routines, 2);
 }
 
 const char* titles[] = {"Example Script 1", "Example Script 2"};
@@ -0,0 +1,57 @@
+/**
+ * @file libLCD > Autonomous Routines
+ */
+#include "routine.h"
+
+void routineInit(routine_t* rt, int (*body)(routine_t*), void* arg, const char* name) {
+	rt->body = body;
+	rt->arg = arg;
+	rt->name = name;
+	rt->_line = 0;
+	rt->_done = false;
+	rt->_now = millis();
+	rt->_wake = rt->_now;
+	rt->_steps = 0;
+	rt->_lastUs = 0;
+	rt->_maxUs = 0;
+	rt->_totalUs = 0;
+}
+
+int routineStep(routine_t* rt) {
+	if (rt->_done)
+		return ROUTINE_DONE;
+	rt->_now = millis();
+
+	unsigned long start = micros();
+	int status = rt->body(rt);
+	unsigned long elapsed = micros() - start;
+
+	rt->_steps++;
+	rt->_lastUs = elapsed;
+	rt->_totalUs += elapsed;
+	if (elapsed > rt->_maxUs)
+		rt->_maxUs = elapsed;
+	return status;
+}
+
+void routineRunAll(routine_t* routines, unsigned int count, unsigned long period) {
+	unsigned long now = millis();
+	bool running = true;
+	while (running) {
+		running = false;
+		for (unsigned int i = 0; i < count; i++)
+			if (routineStep(&routines[i]) != ROUTINE_DONE)
+				running = true;
+		if (running)
+			taskDelayUntil(&now, period);
+	}
+}
+
+void routinePrintReport(routine_t* routines, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		routine_t* rt = &routines[i];
+		unsigned long avg = rt->_steps ? rt->_totalUs / rt->_steps : 0;
+		printf("%s: %lu steps, avg %lu us, max %lu us\n", rt->name ? rt->name : "routine", rt->_steps, avg,
+		       rt->_maxUs);
+	}
+}
@@ -16,6 +16,9 @@
 // Sets the speeds of the left and right wheels of the chassis
 void chassisSet(int left, int right);
 
+// Drives the chassis forwards at power while turning clockwise at turn
+void chassisArcade(int power, int turn);
+
 void chassisInit();
 
 #endif // _CHASSIS_H_
@@ -0,0 +1,108 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Drive Kinematics
+ * @brief Maps chassis motions to the commands of the drive motors for tank, mecanum and X-drive chassis
+ *
+ * A motion is given as a strafe (vx, to the right), a forward speed (vy) and a turn (w, clockwise), each in
+ * [-127,127]. Each motor's command is a sum of these, and when any command would exceed 127 all of them are scaled
+ * down by the same factor. The ratios between the wheels, and therefore the direction of travel and the turning
+ * radius, stay as requested instead of the largest sums being clipped on their own. The commands of all the drive
+ * motors are committed together through a motor group, so every wheel changes in the same motor manager update.
+ *
+ * The motors must be configured with blrsMotorInit (inversion, curve, ...) before the drive is created.
+ *
+ * Example:
+ * @code
+ *		static Drive drive;
+ *		...
+ *		static const unsigned char left[] = {2, 3}, right[] = {4, 5};
+ *		blrsDriveInitTank(&drive, left, 2, right, 2, 3.0);
+ *		...
+ *		blrsDriveArcade(&drive, joystickGetAnalog(1, 3), joystickGetAnalog(1, 4));
+ * @endcode
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#ifndef _DRIVE_H_
+#define _DRIVE_H_
+
+#include "mtrmgr.h"
+
+/*
+ * A drive chassis. Only used through the blrsDrive functions.
+ */
+typedef struct {
+	int group;          // motor group of all the drive motors
+	unsigned char count; // number of motors
+	// Contribution of vx, vy and w (-1, 0 or 1) to the command of each motor, in the order of the group
+	signed char mix[MTRMGR_GROUP_SIZE][3];
+} Drive;
+
+/**
+ * @brief Creates a tank (skid steer) drive
+ *
+ * @param drive
+ *        The drive to initialize
+ *
+ * @param left, right
+ *        The ports of the motors on each side
+ *
+ * @param leftCount, rightCount
+ *        The number of motors on each side, together at most MTRMGR_GROUP_SIZE
+ *
+ * @param slew
+ *        The acceleration in dPWM/millisecond of the motor with the largest change (see blrsMotorGroupInit)
+ *
+ * @returns Returns false if the motor group could not be created
+ */
+bool blrsDriveInitTank(Drive* drive, const unsigned char* left, int leftCount, const unsigned char* right,
+                       int rightCount, float slew);
+
+/**
+ * @brief Creates a mecanum drive, or an X-drive (omni wheels at 45 degrees in the corners). Both move the same way
+ *        for the same wheel commands.
+ *
+ * @param drive
+ *        The drive to initialize
+ *
+ * @param frontLeft, frontRight, backLeft, backRight
+ *        The port of the motor of each wheel. Each motor must drive the robot forwards on a positive command.
+ *
+ * @param slew
+ *        The acceleration in dPWM/millisecond of the motor with the largest change (see blrsMotorGroupInit)
+ *
+ * @returns Returns false if the motor group could not be created
+ */
+bool blrsDriveInitHolonomic(Drive* drive, unsigned char frontLeft, unsigned char frontRight, unsigned char backLeft,
+                            unsigned char backRight, float slew);
+
+/**
+ * @brief Moves the chassis. A tank drive ignores vx.
+ *
+ * @param vx
+ *        Strafe speed, positive to the right
+ *
+ * @param vy
+ *        Forward speed
+ *
+ * @param w
+ *        Turning speed, positive clockwise
+ *
+ * @returns Returns true if the commands were committed
+ */
+bool blrsDriveSet(Drive* drive, int vx, int vy, int w);
+
+/**
+ * @brief Moves the chassis from a forward speed and a turning speed, e.g. the two axes of one joystick
+ */
+bool blrsDriveArcade(Drive* drive, int power, int turn);
+
+/**
+ * @brief Moves a tank drive from the speeds of its left and right sides. If either is outside [-127,127] both
+ *        are scaled down proportionally.
+ */
+bool blrsDriveTank(Drive* drive, int left, int right);
+
+#endif
@@ -52,6 +52,7 @@ extern "C" {
 
 #include "chassis.h"
 #include "claw.h"
+#include "drive.h"
 #include "lift.h"
 #include "mtrmgr.h"
 
@@ -15,30 +15,221 @@
 
 #include <API.h>
 
-#define SLEW_DELTA_T 20 // the update rate for the motors in ms
-#define NUM_MOTORS 10
+#define SLEW_DELTA_T 20 // the default update rate for the motors in ms, see motorManagerSetTiming
 
-#define MUTEX_TAKE_TIMEOUT 100
+#define MTRMGR_FRAME_PERIOD 18500 // nominal period (usec) at which the master processor sends outputs to the motors
+#define MTRMGR_FRAME_LEAD 2000    // default time (usec) between a frame locked update and the frame it is for
+#define NUM_MOTORS 10
 
 #define DEFAULT_SLEW_RATE 0.75
 
+// Slew rates are stored in fixed point with this many fractional bits (1/65536 PWM per millisecond)
+#define SLEW_FRACTION_BITS 16
+// Longest interval (ms) applied in a single slew step. Keeps the fixed-point step from overflowing.
+#define SLEW_MAX_DT 255
+
+// One output table entry per command in [-127,127]
+#define MTRMGR_LUT_SIZE 255
+
+#define MTRMGR_NUM_GROUPS 4 // number of motor groups available
+#define MTRMGR_GROUP_SIZE 6 // most motors in one group
+
+/*
+ * Thermal model of the 393 motor PTCs and the two Cortex breakers (ports 1-5 and 6-10). Each PTC is modelled as a
+ * first order I^2 heating with the given time constant; it trips when the heating reaches the square of its trip
+ * current. The model only runs once enabled with motorManagerSetThermalLimit; set MTRMGR_THERMAL to 0 to remove it.
+ */
+#ifndef MTRMGR_THERMAL
+#define MTRMGR_THERMAL 1
+#endif
+#define MTRMGR_STALL_CURRENT 4800  // current (mA) of a stalled 393 motor at full power
+#define MTRMGR_MOTOR_TRIP 1800     // current (mA) that eventually trips the PTC of a 393 motor
+#define MTRMGR_MOTOR_TAU 6000      // thermal time constant (ms) of a 393 motor PTC
+#define MTRMGR_BREAKER_TRIP 4000   // current (mA) that eventually trips a Cortex port group breaker
+#define MTRMGR_BREAKER_TAU 12000   // thermal time constant (ms) of a Cortex breaker
+#define MTRMGR_THERMAL_LIMIT 90    // outputs are limited to hold heating at this percentage of the trip current
+
+#define MTRMGR_PRIORITY_LEVELS 4 // priorities for sharing the current budget, see blrsMotorSetPriority
+
+// Set MTRMGR_STATS to 0 to remove the motor manager statistics (motorManagerGetStats)
+#ifndef MTRMGR_STATS
+#define MTRMGR_STATS 1
+#endif
+// Command latency histogram buckets: under 1, 2, 4, 8, 16, 32 and 64 ms, and 64 ms or more
+#define MTRMGR_LATENCY_BUCKETS 8
+
+/*
+ * Port log format (see motorManagerLogStart). The stream starts with the 4 bytes of MTRMGR_LOG_MAGIC and a version
+ * byte, followed by one record for each update that changed a logged value:
+ *   - time: 1 byte of milliseconds since the previous record, or 255 followed by the 4 byte (little endian) millis()
+ *   - mask: 3 bytes (little endian). Bits 0-9 are set for the ports whose command changed, bits 10-19 for the ports
+ *     whose output changed, and MTRMGR_LOG_KEY for a key record, whose values start from 0 instead of the previous
+ *     ones. The first record and the first one after a dropped record are key records.
+ *   - for each set bit from the lowest, 1 byte of change in [-127,127], or MTRMGR_LOG_ESCAPE followed by the value
+ * Commands are in the direction of blrsMotorSet (before inversion); outputs are the values given to motorSet.
+ */
+#define MTRMGR_LOG_MAGIC "BLML"
+#define MTRMGR_LOG_VERSION 1
+#define MTRMGR_LOG_KEY (1UL << 23)
+#define MTRMGR_LOG_ESCAPE 0x80
+#define MTRMGR_LOG_RECORD_MAX (5 + 3 + 2 * 2 * NUM_MOTORS) // longest record in bytes
+
+/*
+ * Set MTRMGR_HOST to 1 to build the motor manager on a computer against tools/mtrmgr_host.c, which stands in for the
+ * PROS functions with a virtual clock and port array. No task runs there; updates are stepped with motorManagerStep.
+ */
+#ifndef MTRMGR_HOST
+#define MTRMGR_HOST 0
+#endif
+
 /*
 * This defines a "Motor" and all of its corresponding information.
 * Most of this information is only used internally within SML.
 */
 typedef struct {
 	unsigned char port;      // port number of given motor
-	int cmd;                 // commanded pwm value
-	float slewrate;          // caps the motor's acceleration
+	volatile unsigned int _command; // packed commanded pwm value and flags, written by blrsMotorSet
+	unsigned int slewrate;   // caps the motor's acceleration, in PWM/millisecond with SLEW_FRACTION_BITS
+	unsigned int jerk;       // caps the change of the slew, in PWM/millisecond^2 with SLEW_FRACTION_BITS. 0 to disable
 	char inverted;           // flips the motor output to avoid electrically flipping motors
 	int (*recalculate)(int); // used to scale the motor output for trueSpeed or other scalings
+	const signed char* curve; // optional 128 entry curve table applied after recalculate (see mtrmgrTrueSpeed)
+	unsigned char deadband;  // smallest output magnitude that moves the motor, nonzero outputs are rescaled above it
 
 	unsigned long _lastUpdate; // time (msec) of last commanded value
 	int _prev;                 // past commanded value
+	int _out;                  // last value given to motorSet, so the manager never has to call motorGet
+	unsigned int _slewRemainder; // fraction of a PWM step carried over to the next tick
+	int _position;             // jerk limited slewing: output before recalculation, with SLEW_FRACTION_BITS
+	int _rate;                 // jerk limited slewing: current slew in PWM/millisecond, with SLEW_FRACTION_BITS
+	signed char _lut[MTRMGR_LUT_SIZE]; // output for every slewed command, built from the stages above
+	unsigned char _group;      // 1 + index of the motor group driving this motor, 0 if none
+	int _request;              // output before thermal limiting
+	int _target;               // command the output is being slewed to in this update, for the port log
+
+	int (*velocity)(void);     // optional speed of the motor, positive in the direction of positive commands
+	int freeSpeed;             // value of velocity when running unloaded at full power
+	int kP, kI;                // velocity control gains, in PWM per unit of velocity (and millisecond) with SLEW_FRACTION_BITS
+	volatile int _velocityTarget; // commanded velocity, used while _command has the velocity flag
+	bool _velocityActive;      // the motor manager is controlling the velocity
+	int _speed;                // velocity read in the current update
+	long long _velocityIntegral; // sum of velocity error times milliseconds
+	unsigned int _heat;        // PTC heating in mA^2 (the square of the current that would give it in steady state)
+	int _current;              // estimated current in mA, positive in the direction of positive commands
+	bool _limited;             // output is being reduced to keep the PTCs from tripping or to fit the current budget
+#if MTRMGR_STATS
+	volatile unsigned long _commandTime; // micros() of the latest blrsMotorSet
+	unsigned int _seenCommand;           // latest _command seen by the motor manager
+#endif
+	unsigned char priority;    // motors with a higher priority are served first from the current budget
+	unsigned char weight;      // share of the current budget relative to the other motors of the same priority
+
+	unsigned char stopMode;    // MTRMGR_STOP_COAST, MTRMGR_STOP_BRAKE or MTRMGR_STOP_HOLD, applied on a command of 0
+	unsigned char stopPower;   // brake: output of the reverse pulse; hold: largest output used to hold
+	unsigned short brakeTime;  // brake: length (msec) of the reverse pulse
+	int (*position)(void);     // hold: position of the mechanism, increasing on positive commands
+	int kHold;                 // hold: PWM per unit of position error, with SLEW_FRACTION_BITS
+	bool _stopping;            // the command is 0 and the stop mode has started
+	signed char _stopDirection; // brake: direction of the motion being braked, 0 once the pulse is over
+	unsigned long _stopStart;  // time (msec) the stop started
+	int _holdTarget;           // hold: position when the stop started
 } Motor;
 
+/*
+ * What a motor does when commanded to 0 with blrsMotorSet, see blrsMotorSetBrake and blrsMotorSetHold
+ */
+#define MTRMGR_STOP_COAST 0 // slew to 0 and let the mechanism coast (the default)
+#define MTRMGR_STOP_BRAKE 1 // drive against the motion for a short pulse, then coast
+#define MTRMGR_STOP_HOLD  2 // hold the position the mechanism was at when stopped
+
+/*
+ * Statistics of one motor port, see MotorManagerStats
+ */
+typedef struct {
+	unsigned long commands;   // commands that changed the output of the port
+	unsigned long latencyMax; // longest time (usec) from a command to its first change of the output
+	unsigned long saturated;  // time (msec) spent at full power (+/-127)
+	unsigned long limited;    // time (msec) spent limited by the thermal model or the current budget
+} MotorStats;
+
+/*
+ * Statistics of the motor manager, see motorManagerGetStats
+ */
+typedef struct {
+	unsigned long updates;   // motor manager updates
+	unsigned long sleeps;    // times the motor manager waited for a change because every motor was settled
+	unsigned long updateTime; // total time (usec) spent in updates
+	unsigned long updateMax; // longest update (usec)
+	// Time from a command (blrsMotorSet or a group commit) to its first change of a port's output, counted in
+	// MTRMGR_LATENCY_BUCKETS buckets. Immediate commands are applied by the caller and are not counted.
+	unsigned long latency[MTRMGR_LATENCY_BUCKETS];
+	unsigned long immediateRaces; // immediate commands re-applied because an update was writing the same port
+	unsigned long groupWaits;     // group commits that waited for another task committing to the same group
+	unsigned long groupDeferrals; // updates that left a group commit for the next one because it was being written
+	MotorStats port[NUM_MOTORS];
+} MotorManagerStats;
+
+/*
+ * Thermal state of a motor port, see blrsMotorGetThermal
+ */
+typedef struct {
+	int current;  // estimated current in mA, positive in the direction of positive commands
+	int heat;     // heating of the motor's PTC as a percentage of its trip point
+	int breaker;  // heating of the port group's Cortex breaker as a percentage of its trip point
+	bool limited; // true if the output is being reduced to keep a PTC from tripping
+} MotorThermal;
+
+/*
+ * A set of motors whose commands are committed together and applied on the same motor manager update.
+ * Groups are created with blrsMotorGroupInit and only used internally by MtrMgr.
+ */
+typedef struct {
+	unsigned char count;                   // number of motors in the group
+	unsigned char ports[MTRMGR_GROUP_SIZE]; // port numbers of the motors [1,10]
+	unsigned int slewrate;                 // acceleration of the fastest changing motor, same units as Motor.slewrate
+
+	// Written by blrsMotorGroupSet, read by the motor manager. _seq is odd while a commit is being written.
+	volatile unsigned int _seq;
+	volatile signed char _commands[MTRMGR_GROUP_SIZE];
+	volatile bool _immediate;
+
+	// Motor manager state
+	unsigned int _applied;                 // _seq of the last commit taken by the motor manager
+	signed char _from[MTRMGR_GROUP_SIZE];  // values of the motors when the commit was taken
+	signed char _to[MTRMGR_GROUP_SIZE];    // commanded values of the commit
+	unsigned int _span;                    // largest distance between _from and _to
+	unsigned int _progress;                // distance travelled along _span, with SLEW_FRACTION_BITS
+#if MTRMGR_STATS
+	volatile unsigned long _commitTime;    // micros() of the latest commit
+#endif
+	unsigned long _lastUpdate;
+} MotorGroup;
+
+/*
+ * Generates the 128 entries of a curve table from a macro or constant expression F(x), x in [0,127], so the table
+ * can be declared const and stored in flash instead of RAM:
+ *
+ *		#define SQUARED(x) ((x) * (x) / 127)
+ *		static const signed char squared[128] = {MTRMGR_LUT_128(SQUARED)};
+ *		...
+ *		blrsMotorSetCurve(port, squared);
+ */
+#define MTRMGR_LUT_8(F, n) F(n), F(n + 1), F(n + 2), F(n + 3), F(n + 4), F(n + 5), F(n + 6), F(n + 7)
+#define MTRMGR_LUT_32(F, n) MTRMGR_LUT_8(F, n), MTRMGR_LUT_8(F, n + 8), MTRMGR_LUT_8(F, n + 16), MTRMGR_LUT_8(F, n + 24)
+#define MTRMGR_LUT_128(F) MTRMGR_LUT_32(F, 0), MTRMGR_LUT_32(F, 32), MTRMGR_LUT_32(F, 64), MTRMGR_LUT_32(F, 96)
+
+/*
+ * Linearizes the speed of a motor driven through an MC29 motor controller. Pass to blrsMotorSetCurve.
+ */
+extern const signed char mtrmgrTrueSpeed[128];
+
 /**
  * @brief Initializes the Motor Manager Task by creating the Motor Mutexes and starting the task.
+ *
+ * The task sleeps while no output can change until a new command or setting arrives, and wakes as soon as one does.
+ * It keeps updating while any motor is slewing, braking, holding, controlling a velocity or has a velocity source.
+ * With the thermal limit enabled (motorManagerSetThermalLimit), it also keeps updating while any output is not 0,
+ * since the thermal model follows the current it draws: only a robot with every output at 0 lets the task sleep.
  */
 void motorManagerInit();
 
@@ -47,6 +238,134 @@ void motorManagerInit();
  */
 void motorManagerStop();
 
+/**
+ * @brief Sets when the motor manager updates the motors. Updates happen at the times (in micros()) that are a
+ *        multiple of period after phase. The default is every SLEW_DELTA_T milliseconds.
+ *
+ * @param period
+ *        Time between updates in microseconds, at least 1000
+ *
+ * @param phase
+ *        Offset of the updates in microseconds
+ */
+void motorManagerSetTiming(unsigned long period, unsigned long phase);
+
+/**
+ * @brief Aligns the motor manager updates to the frames in which the master processor sends the outputs to the
+ *        motors (about every 18.5 ms), so that a command never waits most of a frame and no two updates fall into
+ *        the same frame. The frames are tracked from motorManagerFrameMark(); until two marks have been seen, and
+ *        when locking is disabled, the timing of motorManagerSetTiming is used.
+ *
+ * @param enabled
+ *        true to align updates to frames
+ *
+ * @param lead
+ *        Time in microseconds between an update and the frame it is for. Updates run up to a millisecond after they
+ *        are scheduled, so this must be more than 1000 plus the update time. MTRMGR_FRAME_LEAD is a safe default.
+ */
+void motorManagerSetFrameLock(bool enabled, unsigned long lead);
+
+/**
+ * @brief Reports that a new frame from the master processor was observed (for example, from a task that watches
+ *        for new joystick data). The frame period and phase are tracked with a phase locked loop, so occasional
+ *        late or missed marks are smoothed over and the updates keep their alignment between marks.
+ */
+void motorManagerFrameMark();
+
+/**
+ * @brief Copies the motor manager statistics, which are collected from motorManagerInit() or the last reset
+ *
+ * @param stats
+ *        Receives the statistics
+ *
+ * @returns Returns false if the statistics were compiled out (MTRMGR_STATS is 0)
+ */
+bool motorManagerGetStats(MotorManagerStats* stats);
+
+/**
+ * @brief Clears the motor manager statistics
+ */
+void motorManagerResetStats();
+
+/**
+ * @brief Prints the motor manager statistics to stdout
+ */
+void motorManagerPrintStats();
+
+/**
+ * @brief Starts logging the command and output of every port in each update to a ring buffer in RAM. Logging never
+ *        blocks the motor manager: a record that does not fit is dropped, and counted. The ring must be emptied with
+ *        motorManagerLogFlush, from one task at a time, often enough to keep up (a few bytes per changed port and
+ *        update).
+ *
+ * @param buffer
+ *        The ring buffer, which must stay valid until motorManagerLogStop
+ *
+ * @param size
+ *        Size of the buffer in bytes, at least MTRMGR_LOG_RECORD_MAX
+ */
+void motorManagerLogStart(unsigned char* buffer, unsigned int size);
+
+/**
+ * @brief Stops logging. Records already in the ring can still be flushed.
+ */
+void motorManagerLogStop();
+
+/**
+ * @brief Writes the records in the ring buffer to a stream, for example a file opened with fopen or uart1.
+ *        Only the calling task waits on the stream.
+ *
+ * @returns The number of bytes written
+ */
+unsigned int motorManagerLogFlush(FILE* stream);
+
+/**
+ * @returns The number of records dropped because the ring buffer was full
+ */
+unsigned long motorManagerLogDropped();
+
+#if MTRMGR_HOST
+/**
+ * @brief Advances the virtual clock to the time of the next update (see motorManagerSetTiming and
+ *        motorManagerSetFrameLock) and runs that update
+ */
+void motorManagerStep();
+
+/**
+ * @returns true if the motor manager task would sleep after the latest update, as nothing can change until a new
+ *          command or setting arrives
+ */
+bool motorManagerHostSettled();
+
+/**
+ * @brief Sets the virtual clock, in microseconds. It starts at 0.
+ */
+void motorManagerHostSetTime(unsigned long time);
+
+/**
+ * @brief Resets every port to an output of 0 and no writes. The virtual clock keeps running, as the motor manager
+ *        expects time to only move forwards.
+ */
+void motorManagerHostReset();
+
+/**
+ * @returns The last output written to a port [1,10] with motorSet
+ */
+int motorManagerHostOutput(int port);
+
+/**
+ * @returns The number of motorSet calls on a port [1,10] since motorManagerHostReset
+ */
+unsigned long motorManagerHostWrites(int port);
+
+/**
+ * @brief Sets a function that every update calls after computing the outputs and before writing them to the ports.
+ *        A blrsMotorSet from the function lands in the window where an immediate command races with the update,
+ *        which a real task only hits by chance. NULL for none.
+ */
+void motorManagerHostSetRaceHook(void (*hook)(void));
+#endif
+
 /**
  * @brief Configures a motor port with inversion, slew, and scaling
  *
@@ -58,13 +377,211 @@ void motorManagerStop();
  *
  * @param slew
  *        The acceleration of the motor in dPWM/millisecond. DEFAULT_SLEW_RATE is available,
- *        which sets dPWM/millisecond to 0.75
+ *        which sets dPWM/millisecond to 0.75. Rates of less than one PWM per update are accumulated
+ *        across updates, so very slow ramps still move.
  *
  * @param recalculate
  *        function pointer to the scaling function for the motor. Supplying NULL will not provide
+ *        any scaling. It is called once per command value here to build the output table, never by the
+ *        motor manager task, so it must only depend on its input.
+ *
+ * @note The output of a motor is looked up in a table composed from recalculate, the curve, the deadband and
+ *       the inversion, in that order. The curve, deadband and priority are reset and can be set afterwards.
  */
 void blrsMotorInit(int port, bool inverted, float slew, int (*recalculate)(int));
 
+/**
+ * @brief Configures a motor port like blrsMotorInit, with jerk limited (S-curve) slewing. Instead of jumping
+ *        straight to the full slew rate, the slew ramps up and back down by at most jerk per millisecond, which
+ *        softens the start and end of every change. The slew is reduced as late as possible, so the motor still
+ *        reaches its command in close to the shortest time the limits allow.
+ *
+ * @param slew
+ *        The largest acceleration of the motor in dPWM/millisecond
+ *
+ * @param jerk
+ *        The largest change of the acceleration in dPWM/millisecond per millisecond. 0 gives the linear slewing
+ *        of blrsMotorInit.
+ *
+ * @note Jerk limiting does not apply while the motor is part of a motor group.
+ */
+void blrsMotorInitSCurve(int port, bool inverted, float slew, float jerk, int (*recalculate)(int));
+
+/**
+ * @brief Applies a curve table to the output of a motor, after its recalculate function
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param curve
+ *        128 output magnitudes for the commands [0,127], mirrored for negative commands. Usually a const table
+ *        such as mtrmgrTrueSpeed or one generated with MTRMGR_LUT_128. NULL removes the curve.
+ */
+void blrsMotorSetCurve(int port, const signed char* curve);
+
+/**
+ * @brief Compensates for the range of small outputs that do not move a motor
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param deadband
+ *        Nonzero outputs are rescaled from [1,127] to [deadband,127]. 0 disables compensation.
+ */
+void blrsMotorSetDeadband(int port, int deadband);
+
+/**
+ * @brief Gives the thermal model a measured speed of the motor, which makes its current estimate much closer.
+ *        Without one, the motor is assumed to be stalled, so that a stall is never underestimated and the motor is
+ *        limited before its PTC trips. A moving motor draws less than that, so without a velocity source it is
+ *        limited sooner than it needs to be.
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param velocity
+ *        Returns the speed of the motor in any unit, positive in the direction of positive commands. It is called
+ *        by the motor manager task every update. NULL removes the velocity source.
+ *
+ * @param freeSpeed
+ *        The speed velocity returns when the motor is running without load at full power
+ */
+void blrsMotorSetVelocitySource(int port, int (*velocity)(void), int freeSpeed);
+
+/**
+ * @brief Sets the gains of the velocity controller used by blrsMotorSetVelocity. The controller adds a feedforward
+ *        of velocity * 127 / freeSpeed (see blrsMotorSetVelocitySource) to a proportional and an integral term.
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param kP
+ *        PWM per unit of velocity error
+ *
+ * @param kI
+ *        PWM per unit of velocity error per millisecond. The integral is limited to what can change the output
+ *        by 127.
+ */
+void blrsMotorSetVelocityGains(int port, float kP, float kI);
+
+/**
+ * @brief Runs a motor at a velocity. The velocity is controlled by the motor manager task in each update, right
+ *        before the output is slewed and applied, so no separate control task is needed. Any later blrsMotorSet
+ *        returns the motor to open loop control.
+ *
+ * @param port
+ *        The port of the motor [1,10], which must have a velocity source
+ *
+ * @param velocity
+ *        The target, in the units of the velocity source
+ *
+ * @returns Returns false for an invalid port, a port without a velocity source or a port in a motor group
+ */
+bool blrsMotorSetVelocity(int port, int velocity);
+
+/**
+ * @brief Reads the thermal model of a motor port. When the model predicts that a motor PTC or Cortex breaker
+ *        would trip, the motor manager reduces the outputs involved to the most current that can be sustained.
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param state
+ *        Receives the thermal state of the port
+ *
+ * @note current and limited are also available when MTRMGR_THERMAL is 0
+ *
+ * @returns Returns false for an invalid port
+ */
+bool blrsMotorGetThermal(int port, MotorThermal* state);
+
+/**
+ * @brief Sets how a motor shares the current budget when the ports together would draw more than it allows
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param priority
+ *        [0,MTRMGR_PRIORITY_LEVELS-1], defaults to 0. Higher priorities are given all the current they need
+ *        first; the first priority that does not fit shares what is left, and lower priorities are stopped.
+ *
+ * @param weight
+ *        [1,255], defaults to 1. Motors of the priority that shares what is left are given current in proportion
+ *        to their weight times the current they ask for.
+ */
+void blrsMotorSetPriority(int port, int priority, int weight);
+
+/**
+ * @brief Makes a motor coast when commanded to 0, which is the default
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ */
+void blrsMotorSetCoast(int port);
+
+/**
+ * @brief Makes a motor brake when commanded to 0: the motor is driven against the direction it was moving in for
+ *        a short pulse, and then coasts. The pulse is slewed like any other command, so a low slew rate spends part
+ *        of the pulse reversing. With a velocity source (see blrsMotorSetVelocitySource) the pulse ends as soon as
+ *        the motor stops; without one, the direction is taken from the output when the stop is commanded.
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param power
+ *        Output of the reverse pulse [0,127]
+ *
+ * @param time
+ *        Length of the reverse pulse in milliseconds
+ *
+ * @note Stop modes apply to blrsMotorSet only, not to motor groups or velocity control
+ */
+void blrsMotorSetBrake(int port, int power, unsigned int time);
+
+/**
+ * @brief Makes a motor hold its position when commanded to 0. The position read when the stop is commanded is held
+ *        with a proportional controller, run in each update and slewed like any other command. The motor manager
+ *        keeps updating while a motor is holding.
+ *
+ * @param port
+ *        The port of the motor [1,10]
+ *
+ * @param position
+ *        Returns the position of the mechanism (e.g. an encoder or potentiometer), increasing on positive commands.
+ *        NULL makes the motor coast.
+ *
+ * @param kP
+ *        PWM per unit of position error
+ *
+ * @param power
+ *        Largest output used to hold [0,127]
+ *
+ * @note Stop modes apply to blrsMotorSet only, not to motor groups or velocity control
+ */
+void blrsMotorSetHold(int port, int (*position)(void), float kP, int power);
+
+/**
+ * @brief Limits the total current drawn by all motor ports, to keep the Cortex from browning out when several
+ *        mechanisms stall together. Applied every update after slewing, using the current estimates of the
+ *        thermal model (see blrsMotorSetVelocitySource and blrsMotorSetPriority).
+ *
+ * @param budget
+ *        Total current in mA, or 0 for no limit (the default)
+ */
+void motorManagerSetCurrentBudget(int budget);
+
+/**
+ * @brief Enables or disables the thermal model, which reduces outputs that would trip a motor PTC or Cortex breaker.
+ *        It is disabled by default. A motor without a velocity source (blrsMotorSetVelocitySource) is assumed to be
+ *        stalled, so give every motor that runs at high power for long a velocity source before enabling the model:
+ *        otherwise a drive at full speed is limited as if it were pushing against a wall.
+ *        Enabling the model starts it cold. Does nothing when MTRMGR_THERMAL is 0.
+ *
+ * @param enabled
+ *        true to follow the heating of every PTC and limit outputs, false to leave outputs alone
+ */
+void motorManagerSetThermalLimit(bool enabled);
+
 /**
  * @brief Change the motor speed
  *
@@ -78,17 +595,74 @@ void blrsMotorInit(int port, bool inverted, float slew, int (*recalculate)(int))
  *        Will change the speed of the motor immediately, bypassing the motor manager ramping and
  *        recalculation if set to true.
  *
- * @returns Returns true if MotorSet was successful.
+ * @note Never blocks. The command is handed to the motor manager with a single atomic write.
+ *
+ * @returns Returns true if MotorSet was successful, false for an invalid port or a port in a motor group
  */
 bool blrsMotorSet(int port, int speed, bool immediate);
 
+/**
+ * @brief Creates a motor group. The motors of a group are commanded together with blrsMotorGroupSet, which
+ *        guarantees that a whole set of commands is applied in the same motor manager update. The motors
+ *        must be configured with blrsMotorInit first; their inversion and output stages still apply, but
+ *        the group's slew rate replaces theirs and blrsMotorSet no longer affects them.
+ *
+ * @param ports
+ *        The ports of the motors [1,10]
+ *
+ * @param count
+ *        Number of ports, at most MTRMGR_GROUP_SIZE
+ *
+ * @param slew
+ *        The acceleration, in dPWM/millisecond, of the motor with the largest change. The other motors are
+ *        slowed down in proportion so that every motor of the group reaches its command at the same time.
+ *
+ * @returns The group number to pass to blrsMotorGroupSet, or -1 if no group is available or the ports are invalid
+ */
+int blrsMotorGroupInit(const unsigned char* ports, int count, float slew);
+
+/**
+ * @brief Commands every motor of a group to the same speed
+ *
+ * @param group
+ *        A group number from blrsMotorGroupInit
+ *
+ * @param commanded
+ *        The PWM value of the motors, forced back into the bounds [-127,127]
+ *
+ * @param immediate
+ *        Skips slewing if set to true. Unlike blrsMotorSet, the commands are still applied by the motor manager
+ *        on its next update so that they stay together.
+ *
+ * @returns Returns true if the command was committed
+ */
+bool blrsMotorGroupSet(int group, int commanded, bool immediate);
+
+/**
+ * @brief Commands each motor of a group to its own speed, in one commit
+ *
+ * @param group
+ *        A group number from blrsMotorGroupInit
+ *
+ * @param commanded
+ *        The PWM value of each motor, in the order of the ports given to blrsMotorGroupInit
+ *
+ * @param immediate
+ *        Skips slewing if set to true (see blrsMotorGroupSet)
+ *
+ * @note Only waits if another task is committing to the same group at the same time.
+ *
+ * @returns Returns true if the commands were committed
+ */
+bool blrsMotorGroupSetEach(int group, const int* commanded, bool immediate);
+
 /**
  * @brief Returns the normalized commanded speed of the motor
  *
  * @param channel
  *          The port of the motor [1,10]
  *
- * @returns Returns the cmd speed of the motor
+ * @returns Returns the cmd speed of the motor, or 0 while the motor is controlling a velocity
  */
 int blrsMotorGet(int port);
 
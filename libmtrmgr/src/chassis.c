@@ -14,28 +14,26 @@
 #include "main.h"    // includes API.h and other headers
 #include "ports.h"
 
+static Drive chassis;
+
 void chassisSet(int left, int right) {
-	blrsMotorSet(CHASSIS_LEFT_MOTOR, left, false);
-	blrsMotorSet(CHASSIS_RGHT_MOTOR, right, false);
+	// Both sides are committed together, so they always change on the same motor manager update
+	blrsDriveTank(&chassis, left, right);
 }
 
-int chassisTrueSpeed(int cmd) {
-	static const unsigned int TrueSpeed[128] = {
-	    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  24, 25, 25, 25, 25, 26, 26, 26,  26, 27, 27,
-	    27, 27, 27, 27, 27, 27, 27, 28, 28, 28, 28, 29, 29, 29, 29, 29, 29, 29, 29, 30, 30, 30, 30,  30, 31, 31,
-	    31, 31, 32, 32, 32, 33, 33, 33, 33, 34, 34, 34, 34, 35, 35, 35, 35, 36, 36, 36, 37, 37, 37,  37, 38, 38,
-	    38, 39, 39, 39, 40, 40, 41, 42, 42, 42, 42, 42, 43, 43, 44, 44, 45, 45, 46, 47, 47, 47, 48,  48, 49, 49,
-	    50, 50, 52, 52, 52, 53, 54, 55, 55, 56, 56, 60, 61, 64, 65, 65, 66, 70, 72, 72, 80, 85, 127, 127}; // True Speed
-	                                                                                                       // array to
-	                                                                                                       // linearize
-	                                                                                                       // motor output
-
-	return (cmd > 0 ? TrueSpeed[cmd] : (-1 * TrueSpeed[-cmd]));
+void chassisArcade(int power, int turn) {
+	// Scales both sides down together when power + turn is out of range, so turning does not flatten out
+	blrsDriveArcade(&chassis, power, turn);
 }
 
 void chassisInit() {
 	// CHASSIS_LEFt_MOTOR is inverted, can accelerate as quickly as 3.0 PWM/millisecond and uses truespeed
-	blrsMotorInit(CHASSIS_LEFT_MOTOR, true, 3.0, &chassisTrueSpeed);
+	blrsMotorInit(CHASSIS_LEFT_MOTOR, true, 3.0, NULL);
+	blrsMotorSetCurve(CHASSIS_LEFT_MOTOR, mtrmgrTrueSpeed);
 	// CHASSIS_RIGHT_MOTOR is uninverted, can accelerate as quickly as 3.0 PWM/millisecond and uses truespeed
-	blrsMotorInit(CHASSIS_RGHT_MOTOR, false, 3.0, &chassisTrueSpeed);
+	blrsMotorInit(CHASSIS_RGHT_MOTOR, false, 3.0, NULL);
+	blrsMotorSetCurve(CHASSIS_RGHT_MOTOR, mtrmgrTrueSpeed);
+	// The chassis is a tank drive, which slews both sides along the same ramp
+	static const unsigned char left[1] = {CHASSIS_LEFT_MOTOR}, right[1] = {CHASSIS_RGHT_MOTOR};
+	blrsDriveInitTank(&chassis, left, 1, right, 1, 3.0);
 }
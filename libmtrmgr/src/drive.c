@@ -0,0 +1,84 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Drive Kinematics
+ * @brief Maps chassis motions to the commands of the drive motors for tank, mecanum and X-drive chassis
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "drive.h"
+
+static void _setMix(Drive* drive, int j, int vx, int vy, int w) {
+	drive->mix[j][0] = vx;
+	drive->mix[j][1] = vy;
+	drive->mix[j][2] = w;
+}
+
+/**
+ * @brief Scales the commands down together if any is outside [-127,127], and commits them to the drive motors.
+ *        The scale is computed once in fixed point, so each motor only needs a multiply and a shift.
+ */
+static bool _commit(Drive* drive, int* commands) {
+	int max = 127;
+	for (int j = 0; j < drive->count; j++) {
+		int magnitude = commands[j] < 0 ? -commands[j] : commands[j];
+		if (magnitude > max)
+			max = magnitude;
+	}
+	if (max > 127) {
+		int scale = (127 << 16) / max; // below 1 << 16, so the products stay within 32 bits
+		for (int j = 0; j < drive->count; j++)
+			commands[j] = (commands[j] * scale + (1 << 15)) >> 16;
+	}
+	return blrsMotorGroupSetEach(drive->group, commands, false);
+}
+
+bool blrsDriveInitTank(Drive* drive, const unsigned char* left, int leftCount, const unsigned char* right,
+                       int rightCount, float slew) {
+	unsigned char ports[MTRMGR_GROUP_SIZE];
+	if (leftCount < 0 || rightCount < 0 || leftCount + rightCount > MTRMGR_GROUP_SIZE)
+		return false;
+	drive->count = leftCount + rightCount;
+	for (int j = 0; j < leftCount; j++) {
+		ports[j] = left[j];
+		_setMix(drive, j, 0, 1, 1);
+	}
+	for (int j = 0; j < rightCount; j++) {
+		ports[leftCount + j] = right[j];
+		_setMix(drive, leftCount + j, 0, 1, -1);
+	}
+	drive->group = blrsMotorGroupInit(ports, drive->count, slew);
+	return drive->group >= 0;
+}
+
+bool blrsDriveInitHolonomic(Drive* drive, unsigned char frontLeft, unsigned char frontRight, unsigned char backLeft,
+                            unsigned char backRight, float slew) {
+	unsigned char ports[4] = {frontLeft, frontRight, backLeft, backRight};
+	drive->count = 4;
+	_setMix(drive, 0, 1, 1, 1);
+	_setMix(drive, 1, -1, 1, -1);
+	_setMix(drive, 2, -1, 1, 1);
+	_setMix(drive, 3, 1, 1, -1);
+	drive->group = blrsMotorGroupInit(ports, 4, slew);
+	return drive->group >= 0;
+}
+
+bool blrsDriveSet(Drive* drive, int vx, int vy, int w) {
+	int commands[MTRMGR_GROUP_SIZE];
+	for (int j = 0; j < drive->count; j++)
+		commands[j] = drive->mix[j][0] * vx + drive->mix[j][1] * vy + drive->mix[j][2] * w;
+	return _commit(drive, commands);
+}
+
+bool blrsDriveArcade(Drive* drive, int power, int turn) {
+	return blrsDriveSet(drive, 0, power, turn);
+}
+
+bool blrsDriveTank(Drive* drive, int left, int right) {
+	int commands[MTRMGR_GROUP_SIZE];
+	for (int j = 0; j < drive->count; j++)
+		commands[j] = drive->mix[j][2] > 0 ? left : right;
+	return _commit(drive, commands);
+}
@@ -8,20 +8,746 @@
  *
  */
 #include "mtrmgr.h"
+#include <string.h>
 
 static Motor motor[10];
-static Mutex mutex[10];
 static TaskHandle motorManagerTaskHandle;
 
+static MotorGroup groups[MTRMGR_NUM_GROUPS];
+static volatile int groupCount;
+
+static Semaphore wake;         // given to wake the motor manager while it waits for a change
+static volatile bool sleeping; // the motor manager is waiting for a change
+
+// Update timing, all in microseconds
+static unsigned long tickPeriod = SLEW_DELTA_T * 1000;
+static unsigned long tickPhase;
+static bool frameLock;
+static unsigned long frameLead = MTRMGR_FRAME_LEAD;
+static unsigned long framePeriod = MTRMGR_FRAME_PERIOD; // tracked period of the master processor frames
+static unsigned long frameTime;                          // tracked time of the latest frame
+static unsigned char frameMarks;                         // number of marks seen, up to 2
+
+// Port log ring buffer: the motor manager writes at logHead, motorManagerLogFlush reads at logTail
+static unsigned char* logBuffer;
+static unsigned int logSize;
+static volatile bool logging;
+static volatile unsigned int logHead, logTail; // bytes written and read since motorManagerLogStart
+static unsigned long logDropped;
+static bool logKey;                            // the next record must be a key record
+static unsigned long logTime;                  // millis() of the latest record
+static int logTarget[NUM_MOTORS], logOut[NUM_MOTORS]; // values as of the latest record
+
+#if MTRMGR_STATS
+static MotorManagerStats stats;
+static unsigned int statsFresh;            // bit i is set when motor i has a command that has not changed its output
+static unsigned long statsSince[NUM_MOTORS]; // micros() of that command
+#define STATS(...) __VA_ARGS__
+#else
+#define STATS(...)
+#endif
+
+#if MTRMGR_HOST
+static void (*hostRaceHook)(void); // called between computing and writing the outputs of an update
+#endif
+
+/**
+ * @brief Wakes the motor manager if every motor had settled. Called after anything that may change an output.
+ */
+static inline void _wake() {
+	__sync_synchronize(); // the change must be visible before sleeping is read
+	if (sleeping)
+		semaphoreGive(wake);
+}
+
+const signed char mtrmgrTrueSpeed[128] = {
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  24, 25, 25, 25, 25, 26, 26, 26,  26, 27, 27,
+    27, 27, 27, 27, 27, 27, 27, 28, 28, 28, 28, 29, 29, 29, 29, 29, 29, 29, 29, 30, 30, 30, 30,  30, 31, 31,
+    31, 31, 32, 32, 32, 33, 33, 33, 33, 34, 34, 34, 34, 35, 35, 35, 35, 36, 36, 36, 37, 37, 37,  37, 38, 38,
+    38, 39, 39, 39, 40, 40, 41, 42, 42, 42, 42, 42, 43, 43, 44, 44, 45, 45, 46, 47, 47, 47, 48,  48, 49, 49,
+    50, 50, 52, 52, 52, 53, 54, 55, 55, 56, 56, 60, 61, 64, 65, 65, 66, 70, 72, 72, 80, 85, 127, 127};
+
+/*
+ * Callers and the motor manager exchange commands through Motor._command without locks. A command word holds the
+ * commanded PWM value in its low byte and flags above it; aligned word loads and stores are atomic on the Cortex-M3,
+ * and the manager clears flags with a compare-and-swap (LDREX/STREX) so it never overwrites a newer command.
+ */
+#define COMMAND_IMMEDIATE 0x100 // the command was applied directly by blrsMotorSet and must not be slewed
+#define COMMAND_VELOCITY 0x200  // the manager controls the velocity towards Motor._velocityTarget
+
+static inline unsigned int _commandWord(int commanded, bool immediate) {
+	return (unsigned char)commanded | (immediate ? COMMAND_IMMEDIATE : 0);
+}
+
+static inline int _commandValue(unsigned int command) {
+	return (signed char)(command & 0xFF);
+}
+
+/**
+ * @brief Accepts an immediate command: the manager resumes slewing from the value blrsMotorSet applied.
+ *        Re-applying the value also undoes an update from the manager that raced with blrsMotorSet.
+ */
+static bool _takeImmediate(int i) {
+	unsigned int command = motor[i]._command;
+	if (!(command & COMMAND_IMMEDIATE))
+		return false;
+	if (!__sync_bool_compare_and_swap(&motor[i]._command, command, command & ~COMMAND_IMMEDIATE))
+		return false; // a newer command arrived, it will be handled on the next tick
+	motor[i]._target = motor[i]._prev = _commandValue(command);
+	motor[i]._position = motor[i]._prev << SLEW_FRACTION_BITS;
+	motor[i]._rate = 0;
+	motor[i]._out = motor[i]._request = motor[i]._prev * motor[i].inverted;
+	motorSet(i + 1, motor[i]._out);
+	STATS(motor[i]._seenCommand = command & ~COMMAND_IMMEDIATE);
+	return true;
+}
+
+static inline int _clampOutput(int out) {
+	return out > 127 ? 127 : (out < -127 ? -127 : out);
+}
+
+/**
+ * @brief Composes the output stages of a motor into its output table: recalculate, curve, deadband, inversion.
+ *        Runs at configuration time so that the motor manager only does a table load per motor.
+ */
+static void _buildOutputTable(int i) {
+	Motor* m = &motor[i];
+	for (int cmd = -127; cmd <= 127; cmd++) {
+		int out = _clampOutput(m->recalculate ? m->recalculate(cmd) : cmd);
+		int magnitude = out < 0 ? -out : out;
+		if (m->curve)
+			magnitude = _clampOutput(m->curve[magnitude]);
+		if (m->deadband && magnitude)
+			magnitude = m->deadband + magnitude * (127 - m->deadband) / 127;
+		out = (out < 0 ? -magnitude : magnitude) * m->inverted;
+		m->_lut[cmd + 127] = (signed char)out;
+	}
+}
+
+/**
+ * @returns true if a motor slewing towards a target remaining away at rate can still stop on the target after
+ *          travelling at rate for dt, slowing down by at most jerk per millisecond: remaining - rate * dt >=
+ *          rate^2 / (2 * jerk). Compared without division; the fixed-point products need 64 bits.
+ */
+static inline bool _canStop(long long remaining, long long rate, unsigned long dt, unsigned int jerk) {
+	return 2 * (long long)jerk * (remaining - rate * (long long)dt) >= rate * rate;
+}
+
+/**
+ * @brief One step of jerk limited slewing. Chooses the highest slew, changed by at most jerk * dt, from which the
+ *        motor can still stop on the command.
+ *
+ * @returns The new output of the motor before recalculation
+ */
+static int _sCurveStep(Motor* m, int commanded, unsigned long dt) {
+	int target = commanded << SLEW_FRACTION_BITS;
+	if (m->_position == target && m->_rate == 0)
+		return commanded;
+	// Work in the direction of the target, so a positive rate moves towards it
+	int direction = target > m->_position ? 1 : -1;
+	long long remaining = (long long)(target - m->_position) * direction;
+	long long rate = (long long)m->_rate * direction;
+	long long change = (long long)m->jerk * dt;
+	long long max = m->slewrate;
+
+	long long next = rate + change < max ? rate + change : max;
+	if (rate > 0 && !_canStop(remaining, next, dt, m->jerk)) {
+		next = rate < max ? rate : max; // hold the slew
+		if (!_canStop(remaining, next, dt, m->jerk))
+			next = rate - change; // start braking
+	}
+
+	long long travel = next * (long long)dt;
+	if (next <= 0 && rate > 0) // braked to a stop just short of the target
+		travel = remaining;
+	if (travel >= remaining) {
+		m->_position = target;
+		m->_rate = 0;
+		return commanded;
+	}
+	m->_position += (int)travel * direction;
+	m->_rate = (int)next * direction;
+	return (m->_position + (1 << (SLEW_FRACTION_BITS - 1))) >> SLEW_FRACTION_BITS;
+}
+
+/*
+ * Group commits use a sequence lock: a writer makes _seq odd, writes the commands and makes _seq even again. The motor
+ * manager copies the commands and only takes them if _seq was even and unchanged over the copy, so it never blocks
+ * and never applies half of a commit.
+ */
+
+/**
+ * @brief Takes the latest commit of a group, if one was completely written since the last update
+ */
+static void _takeGroupCommit(MotorGroup* g) {
+	unsigned int seq = g->_seq;
+	if (seq == g->_applied)
+		return;
+	if (seq & 1) {
+		STATS(stats.groupDeferrals++);
+		return; // a commit is being written and will be taken on the next update
+	}
+	__sync_synchronize();
+	signed char commands[MTRMGR_GROUP_SIZE];
+	for (int j = 0; j < g->count; j++)
+		commands[j] = g->_commands[j];
+	bool immediate = g->_immediate;
+	__sync_synchronize();
+	if (g->_seq != seq) {
+		STATS(stats.groupDeferrals++);
+		return; // overwritten while copying
+	}
+
+	g->_applied = seq;
+	g->_span = 0;
+	g->_progress = 0;
+	for (int j = 0; j < g->count; j++) {
+		g->_from[j] = immediate ? commands[j] : motor[g->ports[j] - 1]._prev;
+		g->_to[j] = commands[j];
+		unsigned int distance = g->_to[j] > g->_from[j] ? g->_to[j] - g->_from[j] : g->_from[j] - g->_to[j];
+		if (distance > g->_span)
+			g->_span = distance;
+		STATS(statsFresh |= 1U << (g->ports[j] - 1); statsSince[g->ports[j] - 1] = g->_commitTime);
+	}
+}
+
+/**
+ * @brief Slews every motor of a group along the same ramp, so that each covers the same fraction of its change
+ *        and all of them reach their commands together.
+ */
+static void _groupTick(MotorGroup* g, unsigned long now, int* out) {
+	unsigned long dt = now - g->_lastUpdate;
+	g->_lastUpdate = now;
+	_takeGroupCommit(g);
+
+	unsigned int end = g->_span << SLEW_FRACTION_BITS;
+	if (g->_progress < end) {
+		if (dt > SLEW_MAX_DT)
+			dt = SLEW_MAX_DT;
+		g->_progress += g->slewrate * dt;
+		if (g->_progress > end)
+			g->_progress = end;
+	}
+
+	for (int j = 0; j < g->count; j++) {
+		int i = g->ports[j] - 1;
+		int current = g->_to[j];
+		if (g->_progress < end) // interpolate, _span and _progress are reduced to keep the product within 32 bits
+			current = g->_from[j] + (g->_to[j] - g->_from[j]) * (int)(g->_progress >> 8) / (int)(g->_span << 8);
+		motor[i]._prev = current;
+		motor[i]._target = g->_to[j];
+		out[i] = motor[i]._request = motor[i]._lut[current + 127];
+	}
+}
+
+#if MTRMGR_THERMAL
+static volatile bool thermalEnabled; // set by motorManagerSetThermalLimit
+static unsigned int breakerHeat[2];  // heating of the Cortex breakers of ports 1-5 and 6-10, in mA^2
+
+static unsigned int _isqrt(unsigned int x) {
+	unsigned int root = 0, bit = 1U << 30;
+	while (bit > x)
+		bit >>= 2;
+	while (bit) {
+		if (x >= root + bit) {
+			x -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+			root >>= 1;
+		bit >>= 2;
+	}
+	return root;
+}
+
+/**
+ * @returns The heating of a PTC after carrying current (mA) for dt: it moves towards current^2 with time constant tau
+ */
+static unsigned int _heatAfter(unsigned int heat, unsigned int current, unsigned long dt, unsigned int tau) {
+	long long target = (long long)current * current;
+	if (dt >= tau || target > 0xFFFFFFFFLL)
+		return target > 0xFFFFFFFFLL ? 0xFFFFFFFF : (unsigned int)target;
+	return heat + (target - heat) * (long long)dt / tau;
+}
+
+/**
+ * @returns The most current (mA) a PTC can carry for dt without its heating rising above limit^2. Once there, the
+ *          PTC can carry limit indefinitely.
+ */
+static unsigned int _allowedCurrent(unsigned int heat, unsigned int limit, unsigned long dt, unsigned int tau) {
+	unsigned int hold = limit * limit;
+	if (heat >= hold || dt == 0)
+		return limit;
+	unsigned long long allowed = heat + (unsigned long long)(hold - heat) * tau / dt;
+	return allowed > 0xFFFFFFFFULL ? 0xFFFF : _isqrt((unsigned int)allowed);
+}
+
+/**
+ * @brief Cools every PTC for dt with no current, in steps short enough to keep the model accurate
+ */
+static void _cool(unsigned long dt) {
+	if (dt >= 5 * MTRMGR_BREAKER_TAU) { // under 1% left of any heating, which the integer steps may never reach
+		for (int i = 0; i < NUM_MOTORS; i++)
+			motor[i]._heat = 0;
+		breakerHeat[0] = breakerHeat[1] = 0;
+		return;
+	}
+	while (dt > 0) {
+		unsigned long step = dt > SLEW_MAX_DT ? SLEW_MAX_DT : dt;
+		unsigned int warm = 0;
+		for (int i = 0; i < NUM_MOTORS; i++)
+			warm |= motor[i]._heat = _heatAfter(motor[i]._heat, 0, step, MTRMGR_MOTOR_TAU);
+		for (int b = 0; b < 2; b++)
+			warm |= breakerHeat[b] = _heatAfter(breakerHeat[b], 0, step, MTRMGR_BREAKER_TAU);
+		if (!warm)
+			return;
+		dt -= step;
+	}
+}
+
+/**
+ * @brief Reduces currents that would otherwise trip a motor PTC or Cortex breaker, and updates the breaker model.
+ *        A current is only reduced to the most that can be sustained, so the motor keeps as much torque as possible.
+ */
+static void _thermalLimit(unsigned long dt, int* current, unsigned int* total) {
+	unsigned int motorLimit = MTRMGR_MOTOR_TRIP * MTRMGR_THERMAL_LIMIT / 100;
+	unsigned int breakerLimit = MTRMGR_BREAKER_TRIP * MTRMGR_THERMAL_LIMIT / 100;
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		unsigned int magnitude = current[i] < 0 ? -current[i] : current[i];
+		unsigned int allowed = _allowedCurrent(motor[i]._heat, motorLimit, dt, MTRMGR_MOTOR_TAU);
+		if (magnitude > allowed) {
+			current[i] = current[i] < 0 ? -(int)allowed : (int)allowed;
+			motor[i]._limited = true;
+			total[i >= 5] -= magnitude - allowed;
+		}
+	}
+
+	for (int b = 0; b < 2; b++) {
+		unsigned int allowed = _allowedCurrent(breakerHeat[b], breakerLimit, dt, MTRMGR_BREAKER_TAU);
+		if (total[b] > allowed) { // share the breaker in proportion to what each port asks for
+			for (int i = b * 5; i < b * 5 + 5; i++) {
+				current[i] = current[i] * (int)allowed / (int)total[b];
+				motor[i]._limited = true;
+			}
+			total[b] = allowed;
+		}
+		breakerHeat[b] = _heatAfter(breakerHeat[b], total[b], dt, MTRMGR_BREAKER_TAU);
+	}
+}
+#endif
+
+static unsigned int currentBudget; // total current (mA) allowed across all ports, 0 for no limit
+
+/**
+ * @brief Fits the total current into currentBudget. Priority levels are served from the highest down: a level that
+ *        fits gets everything it asks for, the first level that does not fit shares what is left in proportion to
+ *        weight times current, and the levels below it get nothing.
+ */
+static void _budgetLimit(int* current, unsigned int* total) {
+	unsigned int demand[MTRMGR_PRIORITY_LEVELS] = {0};
+	unsigned long long weighted[MTRMGR_PRIORITY_LEVELS] = {0};
+	if (currentBudget == 0 || total[0] + total[1] <= currentBudget)
+		return;
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		unsigned int magnitude = current[i] < 0 ? -current[i] : current[i];
+		demand[motor[i].priority] += magnitude;
+		weighted[motor[i].priority] += (unsigned long long)magnitude * motor[i].weight;
+	}
+
+	unsigned int remaining = currentBudget;
+	int partial = -1; // the level sharing what is left, levels below it get nothing
+	for (int level = MTRMGR_PRIORITY_LEVELS - 1; level >= 0; level--) {
+		if (demand[level] > remaining) {
+			partial = level;
+			break;
+		}
+		remaining -= demand[level];
+	}
+	if (partial < 0) // the thermal limits already brought the demand within the budget
+		return;
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		int level = motor[i].priority;
+		if (level > partial || current[i] == 0)
+			continue;
+		long long share = 0;
+		if (level == partial && weighted[level] > 0) {
+			long long magnitude = current[i] < 0 ? -current[i] : current[i];
+			share = magnitude * motor[i].weight * remaining / weighted[level];
+		}
+		current[i] = current[i] < 0 ? -(int)share : (int)share;
+		motor[i]._limited = true;
+	}
+}
+
 /**
- * @brief The default recalculate function for RecalculateCommanded (takes input and returns it)
- *        This method is only accessible to this file for organizational purposes and may be opened to other files.
- * @param in
- *        Input value
- * @returns Returns in
+ * @brief Estimates the current of every port from its output and speed, then reduces outputs to keep the PTCs from
+ *        tripping and the total current within the budget. Integer only, and linear in the number of ports.
  */
-static int _defaultRecalculate(int in) {
-	return in;
+static void _currentLimit(unsigned long now, int* out) {
+#if MTRMGR_THERMAL
+	static unsigned long lastUpdate;
+	unsigned long dt = now - lastUpdate;
+	lastUpdate = now;
+	bool thermal = thermalEnabled;
+	if (!thermal)
+		breakerHeat[0] = breakerHeat[1] = 0;
+	else if (dt > SLEW_MAX_DT) { // the motor manager slept, which it only does while every current is zero
+		_cool(dt - tickPeriod / 1000);
+		dt = tickPeriod / 1000;
+	}
+#endif
+	int speed[NUM_MOTORS];
+	int current[NUM_MOTORS];
+	int estimate[NUM_MOTORS]; // current before limiting
+	unsigned int total[2] = {0, 0}; // current through each Cortex breaker
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		Motor* m = &motor[i];
+		// Work in the direction of the command: current follows the output voltage minus the back EMF of the motor.
+		// Without a measured speed, assume the motor is stalled so that a stall is never underestimated.
+		int drive = out[i] * m->inverted;
+		speed[i] = (m->velocity && m->freeSpeed) ? _clampOutput(m->_speed * 127 / m->freeSpeed) : 0;
+		current[i] = estimate[i] = MTRMGR_STALL_CURRENT * (drive - speed[i]) / 127;
+		total[i >= 5] += current[i] < 0 ? -current[i] : current[i];
+		m->_limited = false;
+	}
+
+#if MTRMGR_THERMAL
+	if (thermal)
+		_thermalLimit(dt, current, total);
+#endif
+	_budgetLimit(current, total);
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		Motor* m = &motor[i];
+		if (m->_limited && m->velocity && m->freeSpeed) // output that gives the reduced current at the measured speed
+			out[i] = _clampOutput(speed[i] + current[i] * 127 / MTRMGR_STALL_CURRENT) * m->inverted;
+		else if (m->_limited && estimate[i]) // at the assumed stall, the current is proportional to the output
+			out[i] = out[i] * current[i] / estimate[i];
+		m->_current = current[i];
+#if MTRMGR_THERMAL
+		m->_heat = thermal ? _heatAfter(m->_heat, current[i] < 0 ? -current[i] : current[i], dt, MTRMGR_MOTOR_TAU) : 0;
+#endif
+	}
+}
+
+#if MTRMGR_STATS
+/**
+ * @brief Adds the time since the previous update to the ports that spent it saturated or limited
+ */
+static void _recordHeld(unsigned long now) {
+	static unsigned long lastUpdate;
+	unsigned long dt = now - lastUpdate;
+	lastUpdate = now;
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if (motor[i]._out == 127 || motor[i]._out == -127)
+			stats.port[i].saturated += dt;
+		if (motor[i]._limited)
+			stats.port[i].limited += dt;
+	}
+}
+
+/**
+ * @brief Records the latency of the commands that changed an output in this update
+ */
+static void _recordLatency(unsigned int changed) {
+	unsigned long applied = micros();
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if ((statsFresh & changed) & (1U << i)) {
+			unsigned long latency = applied - statsSince[i];
+			int bucket = 0;
+			for (unsigned long ms = latency / 1000; ms && bucket < MTRMGR_LATENCY_BUCKETS - 1; ms >>= 1)
+				bucket++;
+			stats.latency[bucket]++;
+			stats.port[i].commands++;
+			if (latency > stats.port[i].latencyMax)
+				stats.port[i].latencyMax = latency;
+		}
+	}
+	// A command that did not change its output in the update that took it is not counted
+	statsFresh = 0;
+}
+#endif
+
+/**
+ * @brief One step of the velocity controller of a motor: feedforward from the free speed, plus proportional and
+ *        integral terms. The integral only grows while it can still change the output.
+ *
+ * @returns The command for the motor, which is then slewed like any other command
+ */
+static int _velocityStep(Motor* m, unsigned long dt) {
+	int target = m->_velocityTarget;
+	if (!m->_velocityActive) {
+		m->_velocityActive = true;
+		m->_velocityIntegral = 0;
+	}
+	if (!m->velocity)
+		return 0;
+	int error = target - m->_speed;
+	long long limit = m->kI ? ((long long)127 << SLEW_FRACTION_BITS) / m->kI : 0;
+	m->_velocityIntegral += (long long)error * dt;
+	if (m->_velocityIntegral > limit)
+		m->_velocityIntegral = limit;
+	else if (m->_velocityIntegral < -limit)
+		m->_velocityIntegral = -limit;
+
+	long long out = ((long long)m->kP * error + m->kI * m->_velocityIntegral) >> SLEW_FRACTION_BITS;
+	if (m->freeSpeed)
+		out += (long long)target * 127 / m->freeSpeed;
+	return out > 127 ? 127 : (out < -127 ? -127 : (int)out);
+}
+
+/**
+ * @brief Computes the command of a motor commanded to 0 under the brake or hold stop mode
+ *
+ * @returns The command for the motor, which is then slewed like any other command
+ */
+static int _stopStep(Motor* m, unsigned long now) {
+	if (!m->_stopping) {
+		m->_stopping = true;
+		m->_stopStart = now;
+		int moving = m->velocity ? m->_speed : m->_prev;
+		m->_stopDirection = moving > 0 ? 1 : (moving < 0 ? -1 : 0);
+		if (m->stopMode == MTRMGR_STOP_HOLD)
+			m->_holdTarget = m->position();
+	}
+	if (m->stopMode == MTRMGR_STOP_HOLD) {
+		long long out = ((long long)m->kHold * (m->_holdTarget - m->position())) >> SLEW_FRACTION_BITS;
+		return out > m->stopPower ? m->stopPower : (out < -m->stopPower ? -m->stopPower : (int)out);
+	}
+	// The pulse ends after brakeTime, or as soon as the motor is seen to stop
+	if (now - m->_stopStart >= m->brakeTime || (m->velocity && m->_speed * m->_stopDirection <= 0))
+		m->_stopDirection = 0;
+	return -m->_stopDirection * m->stopPower;
+}
+
+/**
+ * @brief Appends a record of the commands and outputs that changed since the previous record to the port log
+ */
+static void _logTick(unsigned long now) {
+	unsigned char record[MTRMGR_LOG_RECORD_MAX];
+	unsigned long mask = logKey ? MTRMGR_LOG_KEY : 0;
+	unsigned int n = 0;
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if (logKey || motor[i]._target != logTarget[i])
+			mask |= 1UL << i;
+		if (logKey || motor[i]._out != logOut[i])
+			mask |= 1UL << (i + NUM_MOTORS);
+	}
+	if (!mask)
+		return;
+
+	if (!logKey && now - logTime < 255) {
+		record[n++] = now - logTime;
+	}
+	else {
+		record[n++] = 255;
+		for (int b = 0; b < 32; b += 8)
+			record[n++] = now >> b;
+	}
+	for (int b = 0; b < 24; b += 8)
+		record[n++] = mask >> b;
+	for (int i = 0; i < 2 * NUM_MOTORS; i++) {
+		if (!(mask & (1UL << i)))
+			continue;
+		int value = i < NUM_MOTORS ? motor[i]._target : motor[i - NUM_MOTORS]._out;
+		int change = value - (logKey ? 0 : (i < NUM_MOTORS ? logTarget[i] : logOut[i - NUM_MOTORS]));
+		if (change < -127 || change > 127) {
+			record[n++] = MTRMGR_LOG_ESCAPE;
+			record[n++] = value;
+		}
+		else
+			record[n++] = change;
+	}
+
+	unsigned int size = logSize, head = logHead;
+	if (n > size - (head - logTail)) { // full, start again from a key record once there is room
+		logDropped++;
+		logKey = true;
+		return;
+	}
+	for (unsigned int j = 0; j < n; j++)
+		logBuffer[(head + j) % size] = record[j];
+	__sync_synchronize(); // the record must be complete before the reader can see it
+	logHead = head + n;
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		logTarget[i] = motor[i]._target;
+		logOut[i] = motor[i]._out;
+	}
+	logTime = now;
+	logKey = false;
+}
+
+/**
+ * @brief Runs one motor manager update at time now. All outputs are computed first and then applied back to back so
+ *        that every port changes in the same window.
+ */
+static void _motorManagerTick(unsigned long now) {
+	int out[NUM_MOTORS];
+	unsigned int changed = 0; // bit i is set when motor i needs a new output
+	STATS(_recordHeld(now));
+
+	// Read every velocity source once, for the velocity controllers and the thermal model
+	for (int i = 0; i < NUM_MOTORS; i++)
+		if (motor[i].velocity)
+			motor[i]._speed = motor[i].velocity();
+
+	for (int g = 0; g < groupCount; g++)
+		_groupTick(&groups[g], now, out);
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		unsigned int command = motor[i]._command;
+		unsigned long dt = now - motor[i]._lastUpdate;
+		motor[i]._lastUpdate = now;
+		if (motor[i]._group) // driven by _groupTick
+			continue;
+		out[i] = motor[i]._request;
+#if MTRMGR_STATS
+		if (command != motor[i]._seenCommand && !(command & COMMAND_IMMEDIATE)) {
+			motor[i]._seenCommand = command;
+			statsFresh |= 1U << i;
+			statsSince[i] = motor[i]._commandTime;
+		}
+#endif
+		if (command & COMMAND_IMMEDIATE) {
+			_takeImmediate(i);
+			out[i] = motor[i]._request;
+			motor[i]._stopping = false;
+			continue;
+		}
+
+		if (dt > SLEW_MAX_DT)
+			dt = SLEW_MAX_DT;
+		int current = motor[i]._prev;
+		int commanded;
+		if (command & COMMAND_VELOCITY) {
+			commanded = _velocityStep(&motor[i], dt);
+			motor[i]._stopping = false;
+		}
+		else {
+			commanded = _commandValue(command);
+			motor[i]._velocityActive = false;
+			if (commanded == 0 && motor[i].stopMode != MTRMGR_STOP_COAST)
+				commanded = _stopStep(&motor[i], now);
+			else
+				motor[i]._stopping = false;
+		}
+		motor[i]._target = commanded;
+		unsigned int slew = motor[i].slewrate;
+		if (slew == 0) // a slew rate of zero prevents output
+			continue;
+		if (motor[i].jerk) {
+			current = _sCurveStep(&motor[i], commanded, dt);
+		}
+		else {
+			if (commanded == current) // on target
+				continue;
+			// Slewing: extrapolate largest allowable acceleration, unless the requested change is lower.
+			// The fraction of a PWM step that does not fit in this tick is kept for the next one.
+			unsigned int travel = slew * dt + motor[i]._slewRemainder;
+			int step = travel >> SLEW_FRACTION_BITS;
+			motor[i]._slewRemainder = travel & ((1U << SLEW_FRACTION_BITS) - 1);
+			if (commanded > current)
+				current = (current + step > commanded) ? commanded : current + step;
+			else
+				current = (current - step < commanded) ? commanded : current - step;
+			if (current == commanded)
+				motor[i]._slewRemainder = 0;
+		}
+		motor[i]._prev = current;
+
+		out[i] = motor[i]._request = motor[i]._lut[current + 127];
+	}
+
+	_currentLimit(now, out);
+#if MTRMGR_HOST
+	if (hostRaceHook)
+		hostRaceHook();
+#endif
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if (out[i] != motor[i]._out)
+			changed |= 1U << i;
+	}
+
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if (changed & (1U << i)) {
+			motorSet(i + 1, out[i]);
+			motor[i]._out = out[i];
+		}
+	}
+
+	// An immediate blrsMotorSet may have happened while computing the outputs; make sure its value wins.
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		if ((changed & (1U << i)) && _takeImmediate(i)) {
+			STATS(stats.immediateRaces++);
+		}
+	}
+
+	STATS(_recordLatency(changed));
+	if (logging)
+		_logTick(now);
+}
+
+/**
+ * @returns true if no output can change until a new command or setting arrives: every motor is on its command and
+ *          draws no current that the thermal model has to follow, and no motor has a velocity source to read.
+ */
+static bool _settled() {
+	for (int g = 0; g < groupCount; g++)
+		if (groups[g]._seq != groups[g]._applied || groups[g]._progress < (groups[g]._span << SLEW_FRACTION_BITS))
+			return false;
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		Motor* m = &motor[i];
+		if (m->velocity)
+			return false;
+#if MTRMGR_THERMAL
+		if (thermalEnabled && m->_current)
+			return false;
+#endif
+		if (m->_group)
+			continue;
+		unsigned int command = m->_command;
+		int commanded = _commandValue(command);
+		if (command & COMMAND_IMMEDIATE)
+			return false;
+		if (m->slewrate == 0)
+			continue;
+		// Holding needs every update; braking until its pulse is over
+		if (commanded == 0 && !(command & COMMAND_VELOCITY) && m->stopMode != MTRMGR_STOP_COAST &&
+		    (m->stopMode == MTRMGR_STOP_HOLD || !m->_stopping || m->_stopDirection))
+			return false;
+		if (commanded != m->_prev || (m->jerk && m->_position != commanded << SLEW_FRACTION_BITS))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Restarts slewing after the motor manager slept, as if the previous update was one period ago
+ */
+static void _resume(unsigned long now) {
+	for (int i = 0; i < NUM_MOTORS; i++)
+		motor[i]._lastUpdate = now - tickPeriod / 1000;
+	for (int g = 0; g < groupCount; g++)
+		groups[g]._lastUpdate = now - tickPeriod / 1000;
+}
+
+/**
+ * @returns The time (micros) of the first update after now: frameLead before the next frame when locked to the
+ *          master processor frames, otherwise the next multiple of tickPeriod after tickPhase
+ */
+static unsigned long _nextTick(unsigned long now) {
+	if (frameLock && frameMarks >= 2) {
+		long since = (long)(now + frameLead - frameTime);
+		unsigned long frames = since < 0 ? 0 : since / framePeriod + 1;
+		return frameTime + frames * framePeriod - frameLead;
+	}
+	return now + tickPeriod - (now - tickPhase) % tickPeriod;
 }
 
 /**
@@ -31,73 +757,120 @@ static int _defaultRecalculate(int in) {
  *				Do not manually create this task.
  */
 static void _motorManagerTask(void* none) {
-	unsigned long int now;
+	unsigned long next = micros(); // time (micros) the update about to run was scheduled for
 	while (true) {
-		now = millis();
-		for (int i = 0; i < NUM_MOTORS; i++) {
-			// the motorGet function gets a motor between channels 1-10. motor[index] goes from 0-9
-			if (motorGet(i + 1) != motor[i].cmd) {
-				// Motor has not been set to target
-				int current = motor[i]._prev;
-				int commanded = motor[i].cmd;
-				float slew = motor[i].slewrate;
-				int out = 0;
-
-				if (slew == 0) // setting a slew rate of zero prevents output
-					continue;
-				if (commanded != current) {
-					// Slewing
-					if (commanded > current) {
-						out =
-						    current + (int)(slew * (millis() - motor[i]._lastUpdate)); // extrapolate largest allowable acceleration
-						if (out > commanded) // requested change in output is lower than maximum possible
-							out = commanded;
-					}
-					else if (commanded < current) {
-						out =
-						    current - (int)(slew * (millis() - motor[i]._lastUpdate)); // extrapolate largest allowable acceleration
-						if (out < commanded) // requested change in output is lower than maximum possible
-							out = commanded;
-					}
-
-					motor[i]._prev = out;
-					out = motor[i].recalculate(out);
-				}
-
-				// Grab mutex if possible, if it's not available (being changed by MotorSet()), skip the motor check.
-				if (!mutexTake(mutex[i], 5))
-					continue;
-				motorSet(i + 1, out);
-				mutexGive(mutex[i]);
+		STATS(unsigned long start = micros());
+		_motorManagerTick(millis());
+#if MTRMGR_STATS
+		unsigned long duration = micros() - start;
+		stats.updates++;
+		stats.updateTime += duration;
+		if (duration > stats.updateMax)
+			stats.updateMax = duration;
+#endif
+		if (_settled()) {
+			// Nothing changes until a new command arrives, so wait for one instead of waking every update
+			sleeping = true;
+			__sync_synchronize(); // sleeping must be visible before the commands are checked again
+			if (_settled()) {
+				STATS(stats.sleeps++);
+				semaphoreTake(wake, -1);
 			}
-			motor[i]._lastUpdate = millis();
+			sleeping = false;
+			_resume(millis());
+			next = micros();
+			continue; // apply the new command right away
 		}
-		taskDelayUntil(&now, SLEW_DELTA_T);
+		// Advance the schedule from the update it was due at rather than from now, so an update that wakes up early or
+		// late never leads to a second one in the same period. Updates that were missed entirely are skipped.
+		unsigned long now = micros();
+		next = _nextTick(next);
+		if ((long)(next - now) <= 0)
+			next = _nextTick(now);
+		// Sleep whole milliseconds, rounding up so that the update never runs before it is scheduled
+		taskDelay((next - now + 999) / 1000);
 	}
 }
 
+#if MTRMGR_HOST
+void motorManagerStep() {
+	motorManagerHostSetTime(_nextTick(micros()));
+	_motorManagerTick(millis());
+}
+
+bool motorManagerHostSettled() {
+	return _settled();
+}
+
+void motorManagerHostSetRaceHook(void (*hook)(void)) {
+	hostRaceHook = hook;
+}
+#endif
+
 void motorManagerInit() {
 	for (int i = 0; i < NUM_MOTORS; i++) {
-		mutex[i] = mutexCreate();
-		motor[i].recalculate = &_defaultRecalculate;
+		if (!motor[i].inverted) { // not configured with blrsMotorInit, pass commands through unchanged
+			motor[i].inverted = 1;
+			motor[i].weight = 1;
+			_buildOutputTable(i);
+		}
 	}
+	wake = semaphoreCreate();
+	semaphoreTake(wake, 0); // semaphores are created given
 	motorManagerTaskHandle = taskCreate(_motorManagerTask, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_HIGHEST - 1);
 }
 
 void blrsMotorInit(int port, bool inverted, float slewrate, int (*recalculate)(int)) {
+	blrsMotorInitSCurve(port, inverted, slewrate, 0, recalculate);
+}
+
+void blrsMotorInitSCurve(int port, bool inverted, float slewrate, float jerk, int (*recalculate)(int)) {
 	if (port < 1 || port > 10)
 		return;
 	port--;
 	motor[port].port = port + 1;
 	motor[port].inverted = inverted ? -1 : 1;
-	motor[port].slewrate = slewrate;
-	if (!recalculate) {
-		motor[port].recalculate = &_defaultRecalculate;
-	}
-	else {
-		motor[port].recalculate = recalculate;
-	}
+	if (slewrate < 0)
+		slewrate = -slewrate;
+	if (slewrate > 127)
+		slewrate = 127;
+	motor[port].slewrate = (unsigned int)(slewrate * (1U << SLEW_FRACTION_BITS));
+	motor[port]._slewRemainder = 0;
+	if (jerk < 0)
+		jerk = -jerk;
+	if (jerk > 127)
+		jerk = 127;
+	motor[port].jerk = (unsigned int)(jerk * (1U << SLEW_FRACTION_BITS));
+	motor[port]._position = 0;
+	motor[port]._rate = 0;
+	motor[port].recalculate = recalculate;
+	motor[port].curve = NULL;
+	motor[port].deadband = 0;
+	motor[port].priority = 0;
+	motor[port].weight = 1;
+	motor[port].stopMode = MTRMGR_STOP_COAST;
+	motor[port]._stopping = false;
+	_buildOutputTable(port);
 	motor[port]._prev = 0;
+	_wake();
+}
+
+void blrsMotorSetCurve(int port, const signed char* curve) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	motor[port].curve = curve;
+	_buildOutputTable(port);
+	_wake();
+}
+
+void blrsMotorSetDeadband(int port, int deadband) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	motor[port].deadband = deadband < 0 ? 0 : (deadband > 127 ? 127 : deadband);
+	_buildOutputTable(port);
+	_wake();
 }
 
 void motorManagerStop() {
@@ -113,16 +886,13 @@ bool blrsMotorSet(int port, int commanded, bool immediate) {
 	else if (commanded < -127)
 		commanded = -127;
 	port--;
-	if (immediate) {
-		// if not able to take control in time then exit and unsuccessful
-		if (!mutexTake(mutex[port], MUTEX_TAKE_TIMEOUT)) {
-			return false;
-		}
+	if (motor[port]._group)
+		return false;
+	STATS(motor[port]._commandTime = micros());
+	motor[port]._command = _commandWord(commanded, immediate);
+	if (immediate)
 		motorSet(port + 1, commanded * motor[port].inverted);
-		motor[port]._prev = commanded * motor[port].inverted;
-		mutexGive(mutex[port]);
-	}
-	motor[port].cmd = commanded * motor[port].inverted;
+	_wake();
 	return true;
 }
 
@@ -130,5 +900,277 @@ int blrsMotorGet(int port) {
 	if (port > 10 || port < 1)
 		return 0;
 	port--;
-	return motor[port].cmd * motor[port].inverted;
+	return _commandValue(motor[port]._command);
+}
+
+int blrsMotorGroupInit(const unsigned char* ports, int count, float slewrate) {
+	if (groupCount >= MTRMGR_NUM_GROUPS || count < 1 || count > MTRMGR_GROUP_SIZE)
+		return -1;
+	for (int j = 0; j < count; j++)
+		if (ports[j] < 1 || ports[j] > 10)
+			return -1;
+
+	int group = groupCount;
+	MotorGroup* g = &groups[group];
+	g->count = count;
+	if (slewrate < 0)
+		slewrate = -slewrate;
+	if (slewrate > 127)
+		slewrate = 127;
+	g->slewrate = (unsigned int)(slewrate * (1U << SLEW_FRACTION_BITS));
+	for (int j = 0; j < count; j++) {
+		g->ports[j] = ports[j];
+		g->_from[j] = g->_to[j] = motor[ports[j] - 1]._prev;
+		motor[ports[j] - 1]._group = group + 1;
+	}
+	groupCount = group + 1; // publish the group to the motor manager once it is complete
+	return group;
+}
+
+bool blrsMotorGroupSet(int group, int commanded, bool immediate) {
+	int commands[MTRMGR_GROUP_SIZE];
+	for (int j = 0; j < MTRMGR_GROUP_SIZE; j++)
+		commands[j] = commanded;
+	return blrsMotorGroupSetEach(group, commands, immediate);
+}
+
+bool blrsMotorGroupSetEach(int group, const int* commanded, bool immediate) {
+	if (group < 0 || group >= groupCount)
+		return false;
+	MotorGroup* g = &groups[group];
+
+	unsigned int seq = g->_seq;
+	while ((seq & 1) || !__sync_bool_compare_and_swap(&g->_seq, seq, seq + 1)) {
+		if (seq & 1) { // another task is committing, and may have a lower priority than this one, so let it finish
+			STATS(__sync_fetch_and_add(&stats.groupWaits, 1));
+			taskDelay(1);
+		}
+		seq = g->_seq;
+	}
+	for (int j = 0; j < g->count; j++)
+		g->_commands[j] = _clampOutput(commanded[j]);
+	g->_immediate = immediate;
+	STATS(g->_commitTime = micros());
+	__sync_synchronize();
+	g->_seq = seq + 2;
+	_wake();
+	return true;
+}
+
+void blrsMotorSetVelocitySource(int port, int (*velocity)(void), int freeSpeed) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	motor[port].freeSpeed = freeSpeed;
+	motor[port].velocity = velocity;
+	_wake();
+}
+
+bool blrsMotorGetThermal(int port, MotorThermal* state) {
+	if (port < 1 || port > 10)
+		return false;
+	port--;
+	state->current = motor[port]._current;
+#if MTRMGR_THERMAL
+	state->heat = motor[port]._heat / (MTRMGR_MOTOR_TRIP * MTRMGR_MOTOR_TRIP / 100);
+	state->breaker = breakerHeat[port >= 5] / (MTRMGR_BREAKER_TRIP * MTRMGR_BREAKER_TRIP / 100);
+#else
+	state->heat = state->breaker = 0;
+#endif
+	state->limited = motor[port]._limited;
+	return true;
+}
+
+void blrsMotorSetPriority(int port, int priority, int weight) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	if (priority < 0)
+		priority = 0;
+	else if (priority >= MTRMGR_PRIORITY_LEVELS)
+		priority = MTRMGR_PRIORITY_LEVELS - 1;
+	motor[port].priority = priority;
+	motor[port].weight = weight < 1 ? 1 : (weight > 255 ? 255 : weight);
+	_wake();
+}
+
+void blrsMotorSetCoast(int port) {
+	if (port < 1 || port > 10)
+		return;
+	motor[port - 1].stopMode = MTRMGR_STOP_COAST;
+	_wake();
+}
+
+void blrsMotorSetBrake(int port, int power, unsigned int time) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	motor[port].stopPower = power < 0 ? 0 : (power > 127 ? 127 : power);
+	motor[port].brakeTime = time > 65535 ? 65535 : time;
+	__sync_synchronize(); // the motor manager task may read the settings as soon as the mode is set
+	motor[port].stopMode = MTRMGR_STOP_BRAKE;
+	_wake();
+}
+
+void blrsMotorSetHold(int port, int (*position)(void), float kP, int power) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	if (!position) {
+		motor[port].stopMode = MTRMGR_STOP_COAST;
+		_wake();
+		return;
+	}
+	motor[port].stopMode = MTRMGR_STOP_COAST; // while the settings change
+	__sync_synchronize();
+	motor[port].position = position;
+	motor[port].kHold = (int)(kP * (1 << SLEW_FRACTION_BITS));
+	motor[port].stopPower = power < 0 ? 0 : (power > 127 ? 127 : power);
+	motor[port]._stopping = false; // latch a new position
+	__sync_synchronize();
+	motor[port].stopMode = MTRMGR_STOP_HOLD;
+	_wake();
+}
+
+void motorManagerSetCurrentBudget(int budget) {
+	currentBudget = budget < 0 ? 0 : budget;
+	_wake();
+}
+
+void motorManagerSetThermalLimit(bool enabled) {
+#if MTRMGR_THERMAL
+	thermalEnabled = enabled;
+	_wake();
+#endif
+}
+
+void motorManagerSetTiming(unsigned long period, unsigned long phase) {
+	tickPeriod = period < 1000 ? 1000 : period;
+	tickPhase = phase;
+	_wake();
+}
+
+void motorManagerSetFrameLock(bool enabled, unsigned long lead) {
+	frameLead = lead;
+	frameLock = enabled;
+	_wake();
+}
+
+void motorManagerFrameMark() {
+	unsigned long now = micros();
+	if (frameMarks == 0) {
+		frameTime = now;
+		frameMarks = 1;
+		return;
+	}
+	// The mark belongs to the nearest predicted frame; marks for missed frames in between are fine
+	unsigned long frames = (now - frameTime + framePeriod / 2) / framePeriod;
+	if (frames == 0)
+		return; // a second mark for the same frame
+	long error = (long)(now - (frameTime + frames * framePeriod));
+	// Follow the phase quickly and the period slowly, so one late mark does not move the updates much
+	frameTime = frameTime + frames * framePeriod + error / 4;
+	framePeriod += error / (long)(16 * frames);
+	if (framePeriod < MTRMGR_FRAME_PERIOD / 2 || framePeriod > MTRMGR_FRAME_PERIOD * 2)
+		framePeriod = MTRMGR_FRAME_PERIOD;
+	if (frameMarks < 2)
+		frameMarks++;
+}
+
+bool motorManagerGetStats(MotorManagerStats* copy) {
+#if MTRMGR_STATS
+	*copy = stats;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void motorManagerResetStats() {
+	STATS(memset(&stats, 0, sizeof(stats)));
+}
+
+void motorManagerLogStart(unsigned char* buffer, unsigned int size) {
+	logging = false; // stop the motor manager from logging while the ring is replaced
+	__sync_synchronize();
+	if (size < MTRMGR_LOG_RECORD_MAX)
+		return;
+	logBuffer = buffer;
+	memcpy(buffer, MTRMGR_LOG_MAGIC, 4);
+	buffer[4] = MTRMGR_LOG_VERSION;
+	logTail = 0;
+	logHead = 5;
+	logDropped = 0;
+	logKey = true;
+	logSize = size;
+	__sync_synchronize();
+	logging = true;
+	_wake();
+}
+
+void motorManagerLogStop() {
+	logging = false;
+}
+
+unsigned int motorManagerLogFlush(FILE* stream) {
+	if (logBuffer == NULL)
+		return 0;
+	unsigned int head = logHead;
+	__sync_synchronize(); // read the records only after seeing that they are complete
+	unsigned int tail = logTail, size = logSize, written = 0;
+	while (tail != head) { // at most two contiguous pieces
+		unsigned int start = tail % size;
+		unsigned int length = head - tail < size - start ? head - tail : size - start;
+		fwrite(logBuffer + start, 1, length, stream);
+		tail += length;
+		written += length;
+	}
+	__sync_synchronize(); // done reading before the space is given back
+	logTail = tail;
+	return written;
+}
+
+unsigned long motorManagerLogDropped() {
+	return logDropped;
+}
+
+void motorManagerPrintStats() {
+#if MTRMGR_STATS
+	MotorManagerStats s = stats;
+	printf("motor manager: %lu updates, %lu sleeps\n", s.updates, s.sleeps);
+	printf("  update time: average %lu us, max %lu us\n", s.updates ? s.updateTime / s.updates : 0, s.updateMax);
+	printf("  command latency (ms):");
+	for (int b = 0; b < MTRMGR_LATENCY_BUCKETS; b++)
+		printf(" %s%d:%lu", b == MTRMGR_LATENCY_BUCKETS - 1 ? ">=" : "<", 1 << (b < 7 ? b : 6), s.latency[b]);
+	printf("\n  immediate races %lu, group waits %lu, group deferrals %lu\n", s.immediateRaces, s.groupWaits,
+	       s.groupDeferrals);
+	printf("  port commands max latency (us) saturated (ms) limited (ms)\n");
+	for (int i = 0; i < NUM_MOTORS; i++)
+		printf("  %4d %8lu %18lu %14lu %12lu\n", i + 1, s.port[i].commands, s.port[i].latencyMax,
+		       s.port[i].saturated, s.port[i].limited);
+#else
+	printf("motor manager statistics are disabled (MTRMGR_STATS)\n");
+#endif
+}
+
+void blrsMotorSetVelocityGains(int port, float kP, float kI) {
+	if (port < 1 || port > 10)
+		return;
+	port--;
+	motor[port].kP = (int)(kP * (1 << SLEW_FRACTION_BITS));
+	motor[port].kI = (int)(kI * (1 << SLEW_FRACTION_BITS));
+}
+
+bool blrsMotorSetVelocity(int port, int velocity) {
+	if (port < 1 || port > 10)
+		return false;
+	port--;
+	if (motor[port]._group || !motor[port].velocity)
+		return false;
+	STATS(motor[port]._commandTime = micros());
+	motor[port]._velocityTarget = velocity;
+	__sync_synchronize(); // the target must be visible before the command that uses it
+	motor[port]._command = COMMAND_VELOCITY;
+	_wake();
+	return true;
 }
@@ -45,7 +45,7 @@ void operatorControl() {
   while (1) {
     power = joystickGetAnalog(1, 2); // vertical axis on left joystick
     turn = joystickGetAnalog(1, 1);  // horizontal axis on left joystick
-    chassisSet(power + turn, power - turn);
+    chassisArcade(power, turn);
 
     clawSet(joystickGetAnalog(1, 4));
 
@@ -0,0 +1,57 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Benchmark
+ * @brief Measures the cost of a motor manager update on a computer for 1 to 10 configured motors
+ *
+ * Every configured motor is kept slewing between full forward and full reverse, so each update does the full work
+ * for every motor. The times are host times and only useful to compare builds and settings with each other.
+ *
+ * Build from the libmtrmgr directory (add -DMTRMGR_THERMAL=0 or -DMTRMGR_STATS=0 to compare):
+ *		gcc -std=gnu99 -O2 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_bench tools/mtrmgr_bench.c src/mtrmgr.c \
+ *		    tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_bench [updates]
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+#include <time.h>
+
+static double _seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+	unsigned long updates = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	if (updates == 0)
+		updates = 1;
+
+	puts("motors  ns/update");
+	for (int count = 1; count <= NUM_MOTORS; count++) {
+		motorManagerHostReset();
+		for (int port = 1; port <= NUM_MOTORS; port++)
+			blrsMotorInit(port, port % 2 == 0, DEFAULT_SLEW_RATE, NULL);
+		motorManagerInit();
+		// Unconfigured motors stay on 0 and are skipped cheaply, as on the robot
+		for (int port = count + 1; port <= NUM_MOTORS; port++)
+			blrsMotorSet(port, 0, true);
+
+		double start = _seconds();
+		for (unsigned long u = 0; u < updates; u++) {
+			// 0.75 PWM/ms takes about 17 updates of 20 ms to go from one end to the other
+			if (u % 20 == 0)
+				for (int port = 1; port <= count; port++)
+					blrsMotorSet(port, (u / 20) % 2 ? -127 : 127, false);
+			motorManagerStep();
+		}
+		double elapsed = _seconds() - start;
+		printf("%6d  %9.1f\n", count, elapsed * 1e9 / updates);
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Group Skew Measurement
+ * @brief Measures how far apart the motors of a drive move when their commands are sent one by one with
+ *        blrsMotorSet, compared to one commit of a motor group through blrsDriveTank
+ *
+ * A tank drive with three motors per side turns in place from rest: the left side is commanded to 127 and the right
+ * side to -127. Sent one by one, the six commands can be split by an update of the motor manager task, which then
+ * starts the first motors one update before the others; every split point is measured. Committed as a group, the
+ * commands cannot be split. For each case the outputs of every update are recorded, and the skew is the difference
+ * between the first and last motor to reach its command, in updates, and the largest difference in the magnitude of
+ * the outputs in any update.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_groupskew tools/mtrmgr_groupskew.c src/mtrmgr.c \
+ *		    src/drive.c tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_groupskew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "drive.h"
+
+#define SIDE 3
+#define MOTORS (2 * SIDE)
+#define MAX_UPDATES 100
+
+static const unsigned char left[SIDE] = {1, 2, 3}, right[SIDE] = {4, 5, 6};
+
+// Ports of the drive in the order chassis code commands them, and their commands
+static int _port(int m) {
+	return m < SIDE ? left[m] : right[m - SIDE];
+}
+
+static int _command(int m) {
+	return m < SIDE ? 127 : -127;
+}
+
+// Velocity sources reporting each motor running at the speed of its output, so the thermal model sees no current
+// and never limits the ramps
+#define FREE_RUNNING(port)                                                                                             \
+	static int _freeRunning##port() {                                                                                  \
+		return motorManagerHostOutput(port);                                                                           \
+	}
+FREE_RUNNING(1)
+FREE_RUNNING(2)
+FREE_RUNNING(3)
+FREE_RUNNING(4)
+FREE_RUNNING(5)
+FREE_RUNNING(6)
+static int (*const freeRunning[MOTORS])(void) = {_freeRunning1, _freeRunning2, _freeRunning3,
+                                                 _freeRunning4, _freeRunning5, _freeRunning6};
+
+// Stops every motor that is not in a group
+static void _stop() {
+	for (int m = 0; m < MOTORS; m++)
+		blrsMotorSet(_port(m), 0, true);
+	motorManagerStep();
+}
+
+// Runs updates until every motor is on its command, and prints the skew between them
+static void _measure(const char* name, int updates) {
+	int reached[MOTORS] = {0}, done = 0, spread = 0;
+	while (done < MOTORS && updates < MAX_UPDATES) {
+		motorManagerStep();
+		updates++;
+		int low = 127, high = 0;
+		for (int m = 0; m < MOTORS; m++) {
+			int out = motorManagerHostOutput(_port(m));
+			int magnitude = out < 0 ? -out : out;
+			low = magnitude < low ? magnitude : low;
+			high = magnitude > high ? magnitude : high;
+			if (!reached[m] && out == _command(m)) {
+				reached[m] = updates;
+				done++;
+			}
+		}
+		if (high - low > spread)
+			spread = high - low;
+	}
+	int first = MAX_UPDATES, last = 0;
+	for (int m = 0; m < MOTORS; m++) {
+		first = reached[m] < first ? reached[m] : first;
+		last = reached[m] > last ? reached[m] : last;
+	}
+	printf("%-28s  %7d  %12d  %12d\n", name, last, last - first, spread);
+}
+
+int main() {
+	for (int m = 0; m < MOTORS; m++) {
+		blrsMotorInit(_port(m), false, DEFAULT_SLEW_RATE, NULL);
+		blrsMotorSetVelocitySource(_port(m), freeRunning[m], 127);
+	}
+	motorManagerInit();
+	puts("commands                      updates  update skew  output skew");
+
+	char name[32];
+	for (int split = 0; split < MOTORS; split++) {
+		_stop();
+		for (int m = 0; m < split; m++)
+			blrsMotorSet(_port(m), _command(m), false);
+		motorManagerStep(); // the update that lands between the calls
+		for (int m = split; m < MOTORS; m++)
+			blrsMotorSet(_port(m), _command(m), false);
+		snprintf(name, sizeof(name), "6 calls, update after %d", split);
+		_measure(name, 1);
+	}
+
+	static Drive drive;
+	blrsDriveInitTank(&drive, left, SIDE, right, SIDE, DEFAULT_SLEW_RATE);
+	_stop();
+	blrsMotorGroupSet(drive.group, 0, true);
+	motorManagerStep(); // an update before the commit, as for the calls
+	blrsDriveTank(&drive, 127, -127);
+	_measure("group commit (blrsDriveTank)", 1);
+	return 0;
+}
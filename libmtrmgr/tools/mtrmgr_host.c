@@ -0,0 +1,97 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Backend
+ * @brief Stands in for the PROS functions used by the motor manager so that it can run on a computer, stepped one
+ *        update at a time against a virtual clock and a recorded port array
+ *
+ * The motor manager task is never started: motorManagerInit() only prepares the motors, and each update is run by
+ * motorManagerStep(). Runs are therefore deterministic, which makes them usable for tests and benchmarks.
+ *
+ * Build from the libmtrmgr directory together with the program driving the motor manager:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o program program.c src/mtrmgr.c src/drive.c tools/mtrmgr_host.c
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+
+#if !MTRMGR_HOST
+#error tools/mtrmgr_host.c must be built with -DMTRMGR_HOST=1
+#endif
+
+// The virtual clock (usec) and the state of every port
+static unsigned long hostTime;
+static int hostOutput[NUM_MOTORS];
+static unsigned long hostWrites[NUM_MOTORS];
+
+void motorManagerHostSetTime(unsigned long time) {
+	hostTime = time;
+}
+
+void motorManagerHostReset() {
+	for (int i = 0; i < NUM_MOTORS; i++) {
+		hostOutput[i] = 0;
+		hostWrites[i] = 0;
+	}
+}
+
+int motorManagerHostOutput(int port) {
+	if (port < 1 || port > 10)
+		return 0;
+	return hostOutput[port - 1];
+}
+
+unsigned long motorManagerHostWrites(int port) {
+	if (port < 1 || port > 10)
+		return 0;
+	return hostWrites[port - 1];
+}
+
+// Stand-ins for the PROS functions used by libmtrmgr
+unsigned long micros() {
+	return hostTime;
+}
+
+unsigned long millis() {
+	return hostTime / 1000;
+}
+
+void motorSet(unsigned char channel, int speed) {
+	if (channel < 1 || channel > 10)
+		return;
+	hostOutput[channel - 1] = speed < -127 ? -127 : (speed > 127 ? 127 : speed);
+	hostWrites[channel - 1]++;
+}
+
+int motorGet(unsigned char channel) {
+	if (channel < 1 || channel > 10)
+		return 0;
+	return hostOutput[channel - 1];
+}
+
+// The only caller waiting is a group commit racing another task, which cannot happen with a single thread
+void taskDelay(const unsigned long msToDelay) {
+	hostTime += msToDelay * 1000;
+}
+
+TaskHandle taskCreate(TaskCode taskCode, const unsigned int stackDepth, void* parameters,
+                      const unsigned int priority) {
+	return NULL;
+}
+
+void taskDelete(TaskHandle taskToDelete) {
+}
+
+Semaphore semaphoreCreate() {
+	return NULL;
+}
+
+bool semaphoreGive(Semaphore semaphore) {
+	return true;
+}
+
+bool semaphoreTake(Semaphore semaphore, const unsigned long blockTime) {
+	return true;
+}
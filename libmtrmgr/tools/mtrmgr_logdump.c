@@ -0,0 +1,121 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Port Log Decoder
+ * @brief Decodes a port log written with motorManagerLogFlush into the command and output time series of each port
+ *
+ * One CSV line is printed per record, with the time in milliseconds followed by the command and output of every
+ * port (or of the one port given). Lines following dropped records are marked with a trailing "key", since values
+ * may have changed in between without being recorded.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -Iinclude -o mtrmgr_logdump tools/mtrmgr_logdump.c
+ *
+ * Usage:
+ *		mtrmgr_logdump <log> [port]
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+#include <string.h>
+
+static FILE* in;
+
+// Reads the next byte of the log, or returns false at its end
+static bool _next(unsigned char* byte) {
+	return fread(byte, 1, 1, in) == 1;
+}
+
+static bool _nextLong(unsigned long* value, int bytes) {
+	unsigned char byte;
+	*value = 0;
+	for (int b = 0; b < bytes; b++) {
+		if (!_next(&byte))
+			return false;
+		*value |= (unsigned long)byte << (8 * b);
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || argc > 3) {
+		puts("usage: mtrmgr_logdump <log> [port]");
+		return 2;
+	}
+	int port = argc == 3 ? atoi(argv[2]) : 0;
+	if (argc == 3 && (port < 1 || port > NUM_MOTORS)) {
+		printf("port must be in [1,%d]\n", NUM_MOTORS);
+		return 2;
+	}
+
+	in = fopen(argv[1], "rb");
+	if (in == NULL) {
+		printf("could not open %s\n", argv[1]);
+		return 2;
+	}
+	unsigned char header[5];
+	if (fread(header, 1, 5, in) != 5 || memcmp(header, MTRMGR_LOG_MAGIC, 4) != 0 || header[4] != MTRMGR_LOG_VERSION) {
+		printf("%s is not a motor manager port log\n", argv[1]);
+		return 2;
+	}
+
+	printf("time");
+	for (int i = 0; i < NUM_MOTORS; i++)
+		if (!port || port == i + 1)
+			printf(",command%d", i + 1);
+	for (int i = 0; i < NUM_MOTORS; i++)
+		if (!port || port == i + 1)
+			printf(",output%d", i + 1);
+	printf("\n");
+
+	int value[2 * NUM_MOTORS] = {0}; // commands, then outputs
+	unsigned long time = 0, records = 0, keys = 0;
+	bool truncated = false;
+	unsigned char byte;
+	while (!truncated && _next(&byte)) {
+		unsigned long mask;
+		if (byte == 255)
+			truncated = !_nextLong(&time, 4);
+		else
+			time += byte;
+		if (truncated || !_nextLong(&mask, 3)) {
+			truncated = true;
+			break;
+		}
+		if (mask & MTRMGR_LOG_KEY) {
+			memset(value, 0, sizeof(value));
+			keys++;
+		}
+		for (int i = 0; i < 2 * NUM_MOTORS && !truncated; i++) {
+			if (!(mask & (1UL << i)))
+				continue;
+			if (!_next(&byte))
+				truncated = true;
+			else if (byte != MTRMGR_LOG_ESCAPE)
+				value[i] += (signed char)byte;
+			else if (_next(&byte))
+				value[i] = (signed char)byte;
+			else
+				truncated = true;
+		}
+		if (truncated)
+			break;
+		records++;
+
+		printf("%lu", time);
+		for (int i = 0; i < 2 * NUM_MOTORS; i++)
+			if (!port || port == i % NUM_MOTORS + 1)
+				printf(",%d", value[i]);
+		// The first record is always a key record, any other one follows dropped records
+		printf("%s\n", (mask & MTRMGR_LOG_KEY) && records > 1 ? ",key" : "");
+	}
+	fclose(in);
+	if (truncated) {
+		printf("# %lu records, the log ends in the middle of a record\n", records);
+		return 1;
+	}
+	printf("# %lu records, %lu restarts after dropped records\n", records, keys ? keys - 1 : 0);
+	return 0;
+}
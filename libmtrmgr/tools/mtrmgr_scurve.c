@@ -0,0 +1,103 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host S-Curve Comparison
+ * @brief Compares linear slewing with jerk limited (S-curve) slewing by the time each takes to reach its command and
+ *        the largest acceleration and jerk of its output
+ *
+ * A port ramps from 0 to 127 and then reverses to -127, with the slew rate limit of DEFAULT_SLEW_RATE and no jerk
+ * limit or several jerk limits. Each ramp is recorded at updates every 1 ms and every SLEW_DELTA_T ms, the default.
+ * The acceleration (the rate of change of the output) and the jerk are taken over windows of SLEW_DELTA_T ms at both
+ * rates, so a jump in acceleration shows as a jerk of the whole jump over one window, and the integer steps of the
+ * output add up to 1 / SLEW_DELTA_T^2 PWM/ms^2 to the jerk at 1 ms. The ideal time is the least time a ramp within
+ * both limits can take.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_scurve tools/mtrmgr_scurve.c src/mtrmgr.c tools/mtrmgr_host.c \
+ *		    -lm
+ *
+ * Usage:
+ *		mtrmgr_scurve
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+#include <math.h>
+
+#define JERKS 4
+#define MAX_TIME 10000 // ms before a ramp is given up on
+#define WINDOW SLEW_DELTA_T
+
+static const float jerks[JERKS] = {0, 0.1, 0.03, 0.01};
+
+// Reports the motor running at the speed of its output, so the thermal model sees no current and never limits it
+static int _freeRunning() {
+	return motorManagerHostOutput(1);
+}
+
+// Least time (ms) to move the output by distance with the acceleration and jerk limits, starting and ending at rest
+static float _idealTime(float distance, float slew, float jerk) {
+	if (jerk == 0)
+		return distance / slew;
+	if (distance >= slew * slew / jerk)
+		return distance / slew + slew / jerk;
+	return 2 * sqrtf(distance / jerk); // the slew limit is never reached
+}
+
+// Runs updates every period ms until the output reaches command, and prints the time, peak acceleration and jerk
+static void _ramp(float jerk, unsigned long period, int command, const char* name) {
+	// Acceleration and jerk are taken over WINDOW ms, n updates, so that outputs held for a few 1 ms updates by the
+	// integer steps do not show as jumps
+	int n = WINDOW / period;
+	int history[2 * WINDOW + 1]; // outputs of the latest 2n + 1 updates, newest first
+	int out = motorManagerHostOutput(1);
+	for (int k = 0; k <= 2 * n; k++)
+		history[k] = out;
+	float distance = command > out ? command - out : out - command;
+	blrsMotorSet(1, command, false);
+	unsigned long start = millis(), time = 0;
+	float peakRate = 0, peakJerk = 0;
+	// Continue for two windows after the command is reached, to include the end of the ramp in the jerk
+	int after = 2 * n;
+	while (after > 0 && millis() - start < MAX_TIME) {
+		motorManagerStep();
+		for (int k = 2 * n; k > 0; k--)
+			history[k] = history[k - 1];
+		history[0] = motorManagerHostOutput(1);
+		if (history[0] == command && !time)
+			time = millis() - start;
+		if (time)
+			after--;
+		float rate = (float)(history[0] - history[n]) / WINDOW;
+		float previous = (float)(history[n] - history[2 * n]) / WINDOW;
+		peakRate = fmaxf(peakRate, fabsf(rate));
+		peakJerk = fmaxf(peakJerk, fabsf(rate - previous) / WINDOW);
+	}
+
+	if (jerk)
+		printf("%5.2f  ", jerk);
+	else
+		printf("%5s  ", "none");
+	printf("%4lu ms  %-8s  %7lu  %8.0f  %11.3f  %13.4f\n", period, name, time,
+	       _idealTime(distance, DEFAULT_SLEW_RATE, jerk), peakRate, peakJerk);
+}
+
+int main() {
+	motorManagerInit();
+	puts(" jerk  updates  ramp      time ms  ideal ms  peak PWM/ms  peak PWM/ms^2");
+	for (int j = 0; j < JERKS; j++) {
+		for (unsigned long period = 1; period <= SLEW_DELTA_T; period += SLEW_DELTA_T - 1) {
+			blrsMotorInitSCurve(1, false, DEFAULT_SLEW_RATE, jerks[j], NULL);
+			blrsMotorSetVelocitySource(1, _freeRunning, 127);
+			blrsMotorSet(1, 0, true);
+			motorManagerStep();
+			motorManagerSetTiming(period * 1000, micros());
+			_ramp(jerks[j], period, 127, "0 to 127");
+			_ramp(jerks[j], period, -127, "reverse");
+			motorManagerSetTiming(SLEW_DELTA_T * 1000, 0);
+		}
+	}
+	return 0;
+}
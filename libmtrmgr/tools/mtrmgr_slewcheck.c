@@ -0,0 +1,105 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Slew Check
+ * @brief Records the output stream of a port ramping from 0 to 127 at several slew rates and update intervals, and
+ *        checks it against the ideal ramp of the slew rate
+ *
+ * Each ramp is run against the virtual clock with updates every 1 ms, every 20 ms, or at random intervals of 1 to
+ * 30 ms. At every update, the output must be exactly the fixed point slew rate times the time since the ramp started,
+ * rounded down: fractions of a PWM step are carried between updates, so neither short intervals nor slow rates lose
+ * any of the ramp. The time the output takes to reach 127 is compared with the ideal 127 / slew, and with the
+ * previous float slewing, which truncated the step of every update on its own and so never moved at all when a step
+ * was below 1 PWM.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_slewcheck tools/mtrmgr_slewcheck.c src/mtrmgr.c \
+ *		    tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_slewcheck
+ *
+ * The exit status is 1 if any output differs from the ideal ramp.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+
+#define RATES 6
+#define PATTERNS 3
+
+static const float rates[RATES] = {0.01, 0.03, 0.1, 0.3, DEFAULT_SLEW_RATE, 3};
+static const char* const patterns[PATTERNS] = {"1 ms", "20 ms", "1-30 ms"};
+
+// Reports the motor running at the speed of its output, so the thermal model sees no current and never limits it
+static int _freeRunning() {
+	return motorManagerHostOutput(1);
+}
+
+static unsigned long _interval(int pattern, unsigned int* seed) {
+	if (pattern == 0)
+		return 1;
+	if (pattern == 1)
+		return SLEW_DELTA_T;
+	*seed = *seed * 1103515245 + 12345;
+	return 1 + (*seed >> 16) % 30;
+}
+
+int main() {
+	motorManagerInit();
+	unsigned long failures = 0;
+	puts("  slew  interval  updates  reach ms  ideal ms  max error  float reach ms");
+	for (int r = 0; r < RATES; r++) {
+		for (int p = 0; p < PATTERNS; p++) {
+			blrsMotorInit(1, false, rates[r], NULL);
+			blrsMotorSetVelocitySource(1, _freeRunning, 127);
+			blrsMotorSet(1, 0, true);
+			motorManagerStep();
+			unsigned long start = millis(); // the ramp starts from this update
+			blrsMotorSet(1, 127, false);
+
+			// The slew rate as stored, in PWM per ms with SLEW_FRACTION_BITS
+			unsigned long long slew = (unsigned long long)(rates[r] * (1U << SLEW_FRACTION_BITS));
+			unsigned long limit = (unsigned long)(2 * 127 / rates[r]) + 1000;
+			unsigned int seed = r * PATTERNS + p + 1;
+			int floatPosition = 0; // the previous float slewing, fed the same intervals
+			unsigned long floatReach = 0, reach = 0, ticks = 0;
+			int error = 0;
+			while (!reach && millis() - start < limit) {
+				unsigned long dt = _interval(p, &seed);
+				motorManagerSetTiming(dt * 1000, micros());
+				motorManagerStep();
+				ticks++;
+
+				unsigned long elapsed = millis() - start;
+				unsigned long long ideal = slew * elapsed >> SLEW_FRACTION_BITS;
+				int expected = ideal > 127 ? 127 : (int)ideal;
+				int out = motorManagerHostOutput(1);
+				int off = out > expected ? out - expected : expected - out;
+				if (off > error)
+					error = off;
+				if (out == 127)
+					reach = elapsed;
+
+				if (!floatReach) {
+					floatPosition += (int)(rates[r] * dt);
+					if (floatPosition >= 127)
+						floatReach = elapsed;
+				}
+			}
+			if (!reach || error)
+				failures++;
+
+			printf("%6.2f  %8s  %7lu  %8lu  %8.0f  %9d  ", rates[r], patterns[p], ticks, reach, 127 / rates[r], error);
+			if (floatReach)
+				printf("%14lu\n", floatReach);
+			else
+				printf("%14s\n", "never");
+		}
+	}
+	motorManagerSetTiming(SLEW_DELTA_T * 1000, 0);
+	printf("%lu ramps differ from the ideal ramp\n", failures);
+	return failures ? 1 : 0;
+}
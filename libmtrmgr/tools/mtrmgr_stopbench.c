@@ -0,0 +1,115 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Stopping Distance Benchmark
+ * @brief Measures how far a simulated mechanism travels after it is commanded to 0 in each stop mode
+ *
+ * The mechanism is a motor whose speed follows its output with a first order lag, optionally loaded by gravity like
+ * a lift. It runs at full power, is commanded to 0 with blrsMotorSet, and is followed for STOP_TIME ms. The
+ * distance is the travel from the stop command to the end, in encoder ticks, and the stop time is when the speed
+ * last fell below 1% of free speed. A lift that drops after stopping shows a negative distance at the end, which is
+ * what the hold mode is for.
+ *
+ * The thermal model is left out: it assumes a motor without a velocity source is stalled, so it would limit the full
+ * power run of some modes and not others.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -DMTRMGR_THERMAL=0 -Iinclude -o mtrmgr_stopbench tools/mtrmgr_stopbench.c \
+ *		    src/mtrmgr.c tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_stopbench
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+
+#if MTRMGR_THERMAL
+#error tools/mtrmgr_stopbench.c must be built with -DMTRMGR_THERMAL=0
+#endif
+
+#define FREE_SPEED 1000 // ticks per second at full power without load
+#define MOTOR_TAU 150   // ms for the speed to get 63% of the way to the speed of a new output
+#define RUN_TIME 1000   // ms at full power before stopping
+#define STOP_TIME 2000  // ms followed after stopping
+#define SLEW 3.0        // PWM per ms, fast enough for the brake pulse to reverse the output
+
+static double speed, position; // ticks per second, ticks
+static double gravity;         // output (PWM) needed to hold the mechanism still
+
+static int _velocity() {
+	return (int)speed;
+}
+
+static int _position() {
+	return (int)position;
+}
+
+// Advances the mechanism by one ms with the output of port 1
+static void _simulate() {
+	double target = (motorManagerHostOutput(1) - gravity) * FREE_SPEED / 127;
+	speed += (target - speed) / MOTOR_TAU;
+	position += speed / 1000;
+}
+
+// Runs the motor manager and the mechanism for time ms
+static void _run(unsigned long time) {
+	for (unsigned long t = 0; t < time; t += SLEW_DELTA_T) {
+		motorManagerStep();
+		for (int ms = 0; ms < SLEW_DELTA_T; ms++)
+			_simulate();
+	}
+}
+
+static void _measure(const char* name, int mode, double load) {
+	blrsMotorInit(1, false, SLEW, NULL);
+	blrsMotorSetVelocitySource(1, NULL, 0);
+	if (mode == 0)
+		blrsMotorSetCoast(1);
+	else if (mode == 1)
+		blrsMotorSetBrake(1, 80, 150);
+	else if (mode == 2) { // the pulse ends as soon as the motor stops
+		blrsMotorSetBrake(1, 80, 400);
+		blrsMotorSetVelocitySource(1, _velocity, FREE_SPEED);
+	}
+	else
+		blrsMotorSetHold(1, _position, 2.0, 127);
+
+	// Start from rest, with a lift held in place
+	gravity = load;
+	speed = position = 0;
+	blrsMotorSet(1, (int)load, true);
+	_run(SLEW_DELTA_T);
+
+	blrsMotorSet(1, 127, false);
+	_run(RUN_TIME);
+	double start = position;
+	blrsMotorSet(1, 0, false);
+	unsigned long stopped = 0;
+	double peak = 0;
+	for (unsigned long t = 0; t < STOP_TIME; t += SLEW_DELTA_T) {
+		_run(SLEW_DELTA_T);
+		if (position - start > peak)
+			peak = position - start;
+		if (speed > FREE_SPEED / 100 || speed < -FREE_SPEED / 100)
+			stopped = t + SLEW_DELTA_T;
+	}
+	printf("%-5s  %-24s  %8.1f  %8.1f  %7lu\n", load ? "lift" : "drive", name, peak, position - start, stopped);
+	blrsMotorSet(1, 0, true);
+	motorManagerStep();
+}
+
+int main() {
+	motorManagerInit();
+	puts("load   stop mode                 peak     end       stop ms");
+	for (int lift = 0; lift < 2; lift++) {
+		double load = lift ? 30 : 0;
+		_measure("coast", 0, load);
+		_measure("brake 80 for 150 ms", 1, load);
+		_measure("brake 80, velocity source", 2, load);
+		_measure("hold, kP 2", 3, load);
+	}
+	return 0;
+}
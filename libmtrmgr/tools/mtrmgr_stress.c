@@ -0,0 +1,226 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Stress Test
+ * @brief Runs motor manager updates in a loop in one thread while other threads send commands with blrsMotorSet, and
+ *        reports how long commands take to reach the ports
+ *
+ * Each checking thread owns one port and sends it commands of random values, alternating immediate and slewed ones,
+ * while hammering threads send commands to the remaining ports as fast as they can. For every checked command, the
+ * time until its port shows the command is measured, in real time and in updates. The port must still show it two
+ * updates later; a port that does not, or never shows the command within a few updates, is counted as stale, which
+ * means a command was lost to a race with the update. Immediate commands that an update re-applied because it wrote
+ * the same port at the same time are counted by the motor manager statistics.
+ *
+ * Ports slew at full speed, so a slewed command reaches its port in the update that takes it. The thermal model
+ * would limit outputs held for hours of virtual time, so it is left out. Every thread yields while waiting, so the
+ * test also completes on a single core. The updater also yields through the race hook of the host backend, between
+ * computing the outputs of an update and writing them, so that commands land in the window where an update can write
+ * a stale output over an immediate command, even on a single core where threads rarely switch anywhere else.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -O2 -pthread -DMTRMGR_HOST=1 -DMTRMGR_THERMAL=0 -Iinclude -o mtrmgr_stress tools/mtrmgr_stress.c \
+ *		    src/mtrmgr.c tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_stress [commands per thread] [checking threads]
+ *
+ * The exit status is 1 if any command was stale.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#if MTRMGR_THERMAL || !MTRMGR_STATS
+#error tools/mtrmgr_stress.c must be built with -DMTRMGR_THERMAL=0 and MTRMGR_STATS
+#endif
+
+#define HAMMER_THREADS 2
+#define STALE_UPDATES 4 // updates after which a command that has not reached its port is stale
+
+static volatile bool running;
+static volatile unsigned long updates; // updates completed
+
+// Latencies of the checked commands, in nanoseconds and in updates: immediate ones first, then slewed ones
+typedef struct {
+	int port;
+	unsigned long count;
+	unsigned long* nanoseconds;
+	unsigned long* updates;
+	unsigned long stale;
+	unsigned long long callTime; // total time spent in blrsMotorSet (ns)
+} checker_t;
+
+static unsigned long long _now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Waits for the updater to complete the given number of updates after since
+static void _awaitUpdates(unsigned long since, unsigned long count) {
+	while (updates - since < count)
+		sched_yield();
+}
+
+// Lets the other threads send commands while an update is between reading the commands and writing the outputs
+static void _raceHook() {
+	sched_yield();
+}
+
+static void* _updater(void* none) {
+	motorManagerHostSetRaceHook(_raceHook);
+	while (running) {
+		motorManagerStep();
+		__sync_fetch_and_add(&updates, 1);
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void* _checker(void* param) {
+	checker_t* c = (checker_t*)param;
+	unsigned int seed = c->port;
+	int inverted = c->port % 2 == 0 ? -1 : 1;
+	int previous = 0;
+	for (unsigned long k = 0; k < c->count; k++) {
+		bool immediate = k % 2 == 0;
+		int value;
+		do
+			value = rand_r(&seed) % 255 - 127;
+		while (value == previous);
+		previous = value;
+
+		unsigned long since = updates;
+		unsigned long long start = _now();
+		blrsMotorSet(c->port, value, immediate);
+		unsigned long long called = _now();
+		c->callTime += called - start;
+
+		// Time until the port shows the command
+		unsigned long long reached = 0;
+		unsigned long taken = 0;
+		while (true) {
+			unsigned long seen = updates; // read first, so the output read after it is at least this recent
+			if (motorManagerHostOutput(c->port) == value * inverted) {
+				reached = _now();
+				taken = seen - since;
+				break;
+			}
+			if (seen - since >= STALE_UPDATES)
+				break;
+			sched_yield();
+		}
+		unsigned long slot = k / 2 + (immediate ? 0 : (c->count + 1) / 2);
+		c->nanoseconds[slot] = reached ? reached - start : 0;
+		c->updates[slot] = taken;
+
+		// It must still show it once the updates racing with the command are over
+		_awaitUpdates(since, 2);
+		if (!reached || motorManagerHostOutput(c->port) != value * inverted)
+			c->stale++;
+	}
+	return NULL;
+}
+
+static void* _hammer(void* param) {
+	int first = *(int*)param;
+	unsigned int seed = first * 7919;
+	while (running) {
+		for (int port = first; port <= NUM_MOTORS; port++)
+			blrsMotorSet(port, rand_r(&seed) % 255 - 127, rand_r(&seed) % 2);
+		sched_yield(); // lets the other threads run on a machine with few cores
+	}
+	return NULL;
+}
+
+static int _compare(const void* a, const void* b) {
+	unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+	return x < y ? -1 : x > y;
+}
+
+// Prints the mean, median, 99th percentile and maximum of count values
+static void _printLatency(const char* kind, unsigned long* ns, unsigned long* taken, unsigned long count) {
+	if (count == 0)
+		return;
+	qsort(ns, count, sizeof(*ns), _compare);
+	qsort(taken, count, sizeof(*taken), _compare);
+	unsigned long long total = 0;
+	for (unsigned long i = 0; i < count; i++)
+		total += ns[i];
+	printf("%-9s %8lu %9.2f %9.2f %9.2f %9.2f %8lu %8lu\n", kind, count, total / 1000.0 / count,
+	       ns[count / 2] / 1000.0, ns[count * 99 / 100] / 1000.0, ns[count - 1] / 1000.0, taken[count * 99 / 100],
+	       taken[count - 1]);
+}
+
+int main(int argc, char** argv) {
+	unsigned long count = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000;
+	int checkers = argc > 2 ? atoi(argv[2]) : 4;
+	if (count < 2)
+		count = 2;
+	if (checkers < 1 || checkers > NUM_MOTORS - 1)
+		checkers = 4;
+
+	for (int port = 1; port <= NUM_MOTORS; port++)
+		blrsMotorInit(port, port % 2 == 0, 127, NULL);
+	motorManagerInit();
+
+	checker_t checker[NUM_MOTORS];
+	for (int c = 0; c < checkers; c++) {
+		checker[c] = (checker_t){c + 1, count, malloc(count * sizeof(unsigned long)),
+		                         malloc(count * sizeof(unsigned long)), 0, 0};
+	}
+	int hammerFrom = checkers + 1;
+
+	running = true;
+	pthread_t updater, hammer[HAMMER_THREADS], check[NUM_MOTORS];
+	unsigned long long start = _now();
+	pthread_create(&updater, NULL, _updater, NULL);
+	for (int h = 0; h < HAMMER_THREADS; h++)
+		pthread_create(&hammer[h], NULL, _hammer, &hammerFrom);
+	for (int c = 0; c < checkers; c++)
+		pthread_create(&check[c], NULL, _checker, &checker[c]);
+	for (int c = 0; c < checkers; c++)
+		pthread_join(check[c], NULL);
+	running = false;
+	for (int h = 0; h < HAMMER_THREADS; h++)
+		pthread_join(hammer[h], NULL);
+	pthread_join(updater, NULL);
+	double seconds = (_now() - start) * 1e-9;
+
+	// Gather every checker's latencies together
+	unsigned long immediate = (count + 1) / 2, slewed = count / 2, stale = 0;
+	unsigned long* ns[2] = {malloc(checkers * immediate * sizeof(unsigned long)),
+	                        malloc(checkers * slewed * sizeof(unsigned long))};
+	unsigned long* taken[2] = {malloc(checkers * immediate * sizeof(unsigned long)),
+	                           malloc(checkers * slewed * sizeof(unsigned long))};
+	unsigned long long callTime = 0;
+	for (int c = 0; c < checkers; c++) {
+		for (unsigned long i = 0; i < immediate; i++) {
+			ns[0][c * immediate + i] = checker[c].nanoseconds[i];
+			taken[0][c * immediate + i] = checker[c].updates[i];
+		}
+		for (unsigned long i = 0; i < slewed; i++) {
+			ns[1][c * slewed + i] = checker[c].nanoseconds[immediate + i];
+			taken[1][c * slewed + i] = checker[c].updates[immediate + i];
+		}
+		stale += checker[c].stale;
+		callTime += checker[c].callTime;
+	}
+
+	MotorManagerStats stats;
+	motorManagerGetStats(&stats);
+	printf("%d checking and %d hammering threads, %lu updates in %.2f s (%.0f per second)\n", checkers,
+	       HAMMER_THREADS, updates, seconds, updates / seconds);
+	printf("blrsMotorSet takes %.0f ns on average\n", (double)callTime / (checkers * count));
+	puts("command     count   mean us median us    p99 us    max us  p99 upd  max upd");
+	_printLatency("immediate", ns[0], taken[0], checkers * immediate);
+	_printLatency("slewed", ns[1], taken[1], checkers * slewed);
+	printf("%lu immediate races re-applied, %lu stale commands\n", stats.immediateRaces, stale);
+	return stale ? 1 : 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Tests
+ * @brief Checks the behavior of motor manager updates on a computer: slew steps, inverted ports, immediate commands
+ *        that bypass slewing or race with an update, when the motor manager considers itself settled, and sharing
+ *        the current budget
+ *
+ * Updates are run one at a time by motorManagerStep, so the motor manager task itself is never started. The tests
+ * cover the decision to sleep (motorManagerHostSettled, which is the check the task makes before sleeping), but not
+ * the task loop around it: the scheduling of updates, the sleep on the wake semaphore and the restart after it only
+ * run on the robot.
+ *
+ * Build and run from the libmtrmgr directory with "make hosttest", or:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_test tools/mtrmgr_test.c src/mtrmgr.c tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_test
+ *
+ * The exit status is 1 if any check fails.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mtrmgr.h"
+
+static unsigned int checks, failures;
+
+#define CHECK(condition, ...)                                                                                          \
+	do {                                                                                                               \
+		checks++;                                                                                                      \
+		if (!(condition)) {                                                                                            \
+			failures++;                                                                                                \
+			printf("FAIL %s:%d: ", __func__, __LINE__);                                                                \
+			printf(__VA_ARGS__);                                                                                       \
+			printf("\n");                                                                                              \
+		}                                                                                                              \
+	} while (0)
+
+// Velocity source of a motor that cannot turn, so that its current is the stall current for its output
+static int _stalled() {
+	return 0;
+}
+
+// Configures every port as a plain slewed motor and brings every output back to 0
+static void _reset() {
+	for (int port = 1; port <= NUM_MOTORS; port++) {
+		blrsMotorInit(port, false, DEFAULT_SLEW_RATE, NULL);
+		blrsMotorSetVelocitySource(port, NULL, 0);
+		blrsMotorSet(port, 0, true);
+	}
+	motorManagerSetCurrentBudget(0);
+	motorManagerSetThermalLimit(false);
+	motorManagerStep();
+	motorManagerHostReset();
+}
+
+// Each update moves the output by the slew rate times the update period, until it reaches the command
+static void _testSlewSteps() {
+	_reset();
+	blrsMotorSet(1, 127, false);
+	int step = (int)(DEFAULT_SLEW_RATE * SLEW_DELTA_T);
+	for (int expected = step; expected < 127; expected += step) {
+		motorManagerStep();
+		CHECK(motorManagerHostOutput(1) == expected, "output %d, expected %d", motorManagerHostOutput(1), expected);
+	}
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(1) == 127, "output %d once slewed, expected 127", motorManagerHostOutput(1));
+
+	unsigned long writes = motorManagerHostWrites(1);
+	motorManagerStep();
+	CHECK(motorManagerHostWrites(1) == writes, "an unchanged output was written again");
+
+	blrsMotorSet(1, 100, false);
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(1) == 127 - step, "output %d slewing down, expected %d", motorManagerHostOutput(1),
+	      127 - step);
+}
+
+// An inverted port outputs the negated command and slews towards it the same way
+static void _testInverted() {
+	_reset();
+	blrsMotorInit(2, true, DEFAULT_SLEW_RATE, NULL);
+	blrsMotorSet(2, 60, false);
+	motorManagerStep();
+	int step = (int)(DEFAULT_SLEW_RATE * SLEW_DELTA_T);
+	CHECK(motorManagerHostOutput(2) == -step, "output %d, expected %d", motorManagerHostOutput(2), -step);
+	for (int i = 0; i < 10; i++)
+		motorManagerStep();
+	CHECK(motorManagerHostOutput(2) == -60, "output %d once slewed, expected -60", motorManagerHostOutput(2));
+	CHECK(blrsMotorGet(2) == 60, "blrsMotorGet %d, expected the command 60", blrsMotorGet(2));
+
+	blrsMotorSet(2, -127, true);
+	CHECK(motorManagerHostOutput(2) == 127, "immediate output %d, expected 127", motorManagerHostOutput(2));
+}
+
+// An immediate command is output right away, skipping the slew, and later commands slew from it
+static void _testImmediate() {
+	_reset();
+	blrsMotorSet(3, 127, true);
+	CHECK(motorManagerHostOutput(3) == 127, "output %d before any update, expected 127", motorManagerHostOutput(3));
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(3) == 127, "output %d after an update, expected 127", motorManagerHostOutput(3));
+
+	blrsMotorSet(3, 0, false);
+	motorManagerStep();
+	int step = (int)(DEFAULT_SLEW_RATE * SLEW_DELTA_T);
+	CHECK(motorManagerHostOutput(3) == 127 - step, "output %d slewing from the immediate command, expected %d",
+	      motorManagerHostOutput(3), 127 - step);
+
+	blrsMotorSet(3, -50, true);
+	CHECK(motorManagerHostOutput(3) == -50, "output %d, expected -50", motorManagerHostOutput(3));
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(3) == -50, "output %d after an update, expected -50", motorManagerHostOutput(3));
+}
+
+// An immediate command sent while an update computes its outputs, from the race hook
+static void _raceImmediate() {
+	motorManagerHostSetRaceHook(NULL);
+	blrsMotorSet(5, -50, true);
+}
+
+// An immediate command that lands after an update read the commands, but before it wrote a slewed output to the same
+// port, is re-applied by that update instead of being overwritten by the stale output
+static void _testImmediateRace() {
+	_reset();
+	blrsMotorSet(5, 127, false);
+	motorManagerStep();
+#if MTRMGR_STATS
+	MotorManagerStats before, after;
+	motorManagerGetStats(&before);
+#endif
+	motorManagerHostSetRaceHook(_raceImmediate);
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(5) == -50, "output %d after an immediate command raced with the update, expected -50",
+	      motorManagerHostOutput(5));
+#if MTRMGR_STATS
+	motorManagerGetStats(&after);
+	CHECK(after.immediateRaces == before.immediateRaces + 1, "%lu immediate races counted, expected 1",
+	      after.immediateRaces - before.immediateRaces);
+#endif
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(5) == -50, "output %d on the next update, expected -50", motorManagerHostOutput(5));
+}
+
+// The motor manager only sleeps once every output is on its command and nothing needs an update to change
+static void _testSettled() {
+	_reset();
+	CHECK(motorManagerHostSettled(), "not settled with every output at 0");
+
+	blrsMotorSet(4, 40, false);
+	CHECK(!motorManagerHostSettled(), "settled with a new command");
+	motorManagerStep();
+	CHECK(!motorManagerHostSettled(), "settled while slewing");
+	for (int i = 0; i < 10; i++)
+		motorManagerStep();
+	CHECK(motorManagerHostOutput(4) == 40, "output %d, expected 40", motorManagerHostOutput(4));
+	CHECK(motorManagerHostSettled(), "not settled once on the command");
+#if MTRMGR_THERMAL
+	// Once enabled, the thermal model follows the current of every output that is not 0, which needs every update
+	motorManagerSetThermalLimit(true);
+	motorManagerStep();
+	CHECK(!motorManagerHostSettled(), "settled while drawing current with the thermal limit");
+	motorManagerSetThermalLimit(false);
+	motorManagerStep();
+	CHECK(motorManagerHostSettled(), "not settled once the thermal limit is disabled");
+#endif
+
+	blrsMotorSet(4, 0, true);
+	CHECK(!motorManagerHostSettled(), "settled with an immediate command to apply");
+	motorManagerStep();
+	motorManagerStep();
+	CHECK(motorManagerHostSettled(), "not settled once back at 0");
+}
+
+// Runs one update of stalled motors at full power on the given ports
+static void _stall(const int* ports, int count) {
+	for (int p = 0; p < count; p++) {
+		blrsMotorSetVelocitySource(ports[p], _stalled, 100);
+		blrsMotorSet(ports[p], 127, true);
+	}
+	motorManagerStep();
+}
+
+static bool _limited(int port) {
+	MotorThermal state;
+	blrsMotorGetThermal(port, &state);
+	return state.limited;
+}
+
+// When every port fits in the budget, no port is limited, whatever its priority
+static void _testBudgetFits() {
+	static const int ports[] = {1, 6};
+	_reset();
+	blrsMotorSetPriority(1, 1, 1);
+	motorManagerSetCurrentBudget(2 * MTRMGR_STALL_CURRENT);
+	_stall(ports, 2);
+	for (int p = 0; p < 2; p++) {
+		CHECK(motorManagerHostOutput(ports[p]) == 127, "port %d output %d with a budget that fits, expected 127",
+		      ports[p], motorManagerHostOutput(ports[p]));
+		CHECK(!_limited(ports[p]), "port %d limited with a budget that fits", ports[p]);
+	}
+}
+
+// Higher priorities get all they ask for, the first one that does not fit shares the rest by weight, and lower
+// priorities are stopped
+static void _testBudgetPriorities() {
+	static const int ports[] = {1, 6, 7, 8};
+	_reset();
+	blrsMotorSetPriority(1, 2, 1);
+	blrsMotorSetPriority(6, 1, 1);
+	blrsMotorSetPriority(7, 1, 3);
+	blrsMotorSetPriority(8, 0, 1);
+	motorManagerSetCurrentBudget(MTRMGR_STALL_CURRENT + 2000); // 2000 mA left after port 1
+	_stall(ports, 4);
+
+	CHECK(motorManagerHostOutput(1) == 127 && !_limited(1), "highest priority output %d limited %d, expected 127",
+	      motorManagerHostOutput(1), _limited(1));
+	// Ports 6 and 7 share 2000 mA 1:3, so 500 mA and 1500 mA at stall
+	int expected6 = 500 * 127 / MTRMGR_STALL_CURRENT, expected7 = 1500 * 127 / MTRMGR_STALL_CURRENT;
+	CHECK(motorManagerHostOutput(6) == expected6, "weight 1 output %d, expected %d", motorManagerHostOutput(6),
+	      expected6);
+	CHECK(motorManagerHostOutput(7) == expected7, "weight 3 output %d, expected %d", motorManagerHostOutput(7),
+	      expected7);
+	CHECK(motorManagerHostOutput(8) == 0, "lowest priority output %d, expected 0", motorManagerHostOutput(8));
+
+	motorManagerSetCurrentBudget(0);
+	motorManagerStep();
+	for (int p = 0; p < 4; p++)
+		CHECK(motorManagerHostOutput(ports[p]) == 127, "port %d output %d without a budget, expected 127", ports[p],
+		      motorManagerHostOutput(ports[p]));
+}
+
+#if MTRMGR_THERMAL
+// The thermal model is off until enabled: full power for a minute is never limited. Once enabled, a motor without a
+// velocity source is assumed stalled, so holding full power long enough to trip its PTC is limited, until the model
+// is disabled again.
+static void _testThermalOptIn() {
+	_reset();
+	blrsMotorSet(1, 127, true);
+	for (int i = 0; i < 3000; i++) // a minute
+		motorManagerStep();
+	MotorThermal state;
+	blrsMotorGetThermal(1, &state);
+	CHECK(motorManagerHostOutput(1) == 127 && !state.limited, "output %d limited %d after a minute with the thermal "
+	      "limit disabled, expected 127", motorManagerHostOutput(1), state.limited);
+	CHECK(state.heat == 0, "heat %d with the thermal limit disabled, expected 0", state.heat);
+
+	motorManagerSetThermalLimit(true);
+	motorManagerStep();
+	blrsMotorGetThermal(1, &state);
+	CHECK(state.current == MTRMGR_STALL_CURRENT, "current %d at full power, expected the stall current %d",
+	      state.current, MTRMGR_STALL_CURRENT);
+	CHECK(!state.limited && state.heat < 100, "limited %d with heat %d right after enabling, expected a cold start",
+	      state.limited, state.heat);
+
+	for (int i = 0; i < 3000; i++)
+		motorManagerStep();
+	blrsMotorGetThermal(1, &state);
+	CHECK(state.limited, "full power for a minute without a velocity source was not limited");
+	CHECK(state.current < MTRMGR_MOTOR_TRIP, "current %d held at full power, not below the PTC trip current %d",
+	      state.current, MTRMGR_MOTOR_TRIP);
+
+	motorManagerSetThermalLimit(false);
+	motorManagerStep();
+	CHECK(motorManagerHostOutput(1) == 127, "output %d once the thermal limit is disabled, expected 127",
+	      motorManagerHostOutput(1));
+	blrsMotorSet(1, 0, true);
+	motorManagerStep();
+}
+
+// Once the breaker model has scaled a group of ports down, what they draw can fit the budget even though the total
+// asked for before the breaker limit does not. Leaves the breaker of ports 6-10 hot, so it runs last.
+static void _testBudgetFitsAfterBreaker() {
+	_reset();
+	motorManagerSetThermalLimit(true);
+	for (int port = 6; port <= 10; port++) {
+		blrsMotorSetVelocitySource(port, _stalled, 100);
+		blrsMotorSet(port, 127 - 20 * (port - 6), true);
+	}
+	for (int i = 0; i < 3000; i++) // a minute of stalling heats the breaker until it limits the ports
+		motorManagerStep();
+
+	int drawn = 0, outputs[NUM_MOTORS + 1];
+	for (int port = 6; port <= 10; port++) {
+		MotorThermal state;
+		blrsMotorGetThermal(port, &state);
+		drawn += state.current;
+		outputs[port] = motorManagerHostOutput(port);
+	}
+	CHECK(_limited(6), "the breaker did not limit the ports");
+	motorManagerSetCurrentBudget(drawn);
+	motorManagerStep();
+	for (int port = 6; port <= 10; port++)
+		CHECK(motorManagerHostOutput(port) == outputs[port], "port %d output %d with a budget of what it draws, "
+		      "expected %d", port, motorManagerHostOutput(port), outputs[port]);
+}
+#endif
+
+int main() {
+	for (int port = 1; port <= NUM_MOTORS; port++)
+		blrsMotorInit(port, false, DEFAULT_SLEW_RATE, NULL);
+	motorManagerInit();
+
+	_testSlewSteps();
+	_testInverted();
+	_testImmediate();
+	_testImmediateRace();
+	_testSettled();
+	_testBudgetFits();
+	_testBudgetPriorities();
+#if MTRMGR_THERMAL
+	_testThermalOptIn();
+	_testBudgetFitsAfterBreaker();
+#endif
+
+	printf("%u checks, %u failed\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file Team BLRS Motor Manager Library (MtrMgr Library)
+ *       > Host Thermal Replay
+ * @brief Replays the commands of a port log through the thermal model, against simulated mechanisms, and reports how
+ *        hot each PTC and breaker gets and how long each port is limited
+ *
+ * The port log is one written on the robot with motorManagerLogStart and motorManagerLogFlush during a match. Without
+ * one, the tool records its own: a 105 s driver control period of the demo clawbot code (chassis.c, lift.c and
+ * claw.c) driven by a scripted driver, logged by the motor manager as on the robot. The driver sprints, cruises and
+ * turns, raises the lift until it hits its stop, closes the claw on a game object and holds it, and opens it again.
+ * From 60 s to 80 s, the driver holds the drive at full power forward.
+ * The recorded commands are then sent back through the demo code (chassisSet, liftSet and clawSet) with the thermal
+ * limit enabled, so a log from a robot must come from one wired like the demo. Each port drives a simulated mechanism
+ * whose speed follows its output with a lag: the drive sides with some friction, the lift against gravity between two
+ * stops and the claw between open and closed on the game object.
+ *
+ * Each log is replayed three ways:
+ *   - driving: every port has a velocity source reading its simulated speed. Normal driving must not be limited.
+ *   - no velocity sources: the thermal model assumes every motor is stalled, which limits normal driving; this is why
+ *     the model is disabled by default.
+ *   - pushing: as driving, but the robot is against a wall from 60 s to 80 s, so the drive is stalled at full power.
+ *     The drive must be limited before its PTCs trip.
+ * A PTC or breaker trips when its heat reaches 100%. With a log from a robot, the pushing replay is left out.
+ *
+ * Build from the libmtrmgr directory:
+ *		gcc -std=gnu99 -DMTRMGR_HOST=1 -Iinclude -o mtrmgr_thermalreplay tools/mtrmgr_thermalreplay.c src/mtrmgr.c \
+ *		    src/drive.c src/chassis.c src/lift.c src/claw.c tools/mtrmgr_host.c
+ *
+ * Usage:
+ *		mtrmgr_thermalreplay [log]
+ *
+ * Without a log, the recording is written to mtrmgr_thermalreplay.log in the current directory. The exit status is 1
+ * if normal driving is limited, pushing is not, or any PTC or breaker trips in either.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "main.h"
+#include "ports.h"
+#include <string.h>
+
+#if !MTRMGR_THERMAL
+#error tools/mtrmgr_thermalreplay.c needs the thermal model, MTRMGR_THERMAL
+#endif
+
+#define MATCH_TIME 105000 // ms of driver control recorded
+#define PUSH_START 60000  // ms into the replay when the robot is pushed against a wall at full power
+#define PUSH_END 80000
+#define MOTOR_TAU 100       // ms for a speed to get 63% of the way to the speed of a new output
+#define LIFT_TRAVEL 100000  // travel between the lift stops, in PWM ms (about 1 s at full power)
+#define LIFT_GRAVITY 25     // output needed to hold the lift still
+#define CLAW_TRAVEL 40000   // travel of the claw from open to closed on the game object
+#define MECHANISMS 4
+#define SCENARIOS 3
+
+enum { LEFT, RIGHT, LIFT, CLAW };
+
+static const int ports[MECHANISMS] = {CHASSIS_LEFT_MOTOR, CHASSIS_RGHT_MOTOR, LIFT_MOTOR, CLAW_MOTOR};
+static const int inverted[MECHANISMS] = {-1, 1, 1, -1}; // as configured by chassisInit, liftInit and clawInit
+static const char* const names[MECHANISMS] = {"left drive", "right drive", "lift", "claw"};
+static const char* const scenarios[SCENARIOS] = {"driving", "no velocity sources", "pushing"};
+
+// Simulated speed (output units, positive in the direction of positive commands) and position of each mechanism
+static double speed[MECHANISMS], position[MECHANISMS];
+static bool pushing;
+
+#define SPEED(m)                                                                                                       \
+	static int _speed##m() {                                                                                           \
+		return (int)speed[m];                                                                                          \
+	}
+SPEED(0)
+SPEED(1)
+SPEED(2)
+SPEED(3)
+static int (*const velocity[MECHANISMS])(void) = {_speed0, _speed1, _speed2, _speed3};
+
+// Advances every mechanism by one ms with the current port outputs
+static void _simulate() {
+	for (int m = 0; m < MECHANISMS; m++) {
+		int drive = motorManagerHostOutput(ports[m]) * inverted[m];
+		double target = m == LIFT ? drive - LIFT_GRAVITY : drive * 0.85;
+		speed[m] += (target - speed[m]) / MOTOR_TAU;
+		if (m <= RIGHT && pushing && speed[m] > 0)
+			speed[m] = 0; // against the wall
+		double travel = m == LIFT ? LIFT_TRAVEL : (m == CLAW ? CLAW_TRAVEL : 0);
+		if (travel) {
+			position[m] += speed[m];
+			if (position[m] <= 0 || position[m] >= travel) { // on a stop, or on the game object
+				position[m] = position[m] <= 0 ? 0 : travel;
+				speed[m] = 0;
+			}
+		}
+	}
+}
+
+static unsigned int _random(unsigned int* seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+// Sends the scripted driver's commands for time t (ms) of driver control through the demo code
+static void _driver(unsigned long t, unsigned int* seed) {
+	static unsigned long segmentEnd;
+	static int power, turn;
+	if (t == 0)
+		segmentEnd = 0;
+	if (t >= PUSH_START && t < PUSH_END) {
+		power = 127;
+		turn = 0;
+		segmentEnd = t;
+	}
+	else if (t >= segmentEnd) { // a new maneuver every 1 to 4 s
+		static const int maneuvers[][2] = {{0, 0}, {127, 0}, {-127, 0}, {70, 0}, {-70, 0}, {0, 110}, {0, -110},
+		                                   {100, 40}, {100, -40}};
+		int k = _random(seed) % (sizeof(maneuvers) / sizeof(maneuvers[0]));
+		power = maneuvers[k][0];
+		turn = maneuvers[k][1];
+		segmentEnd = t + 1000 + _random(seed) % 3000;
+	}
+	chassisArcade(power, turn);
+
+	// Every 9 s: raise the lift a little past its stop, let it drop and bring it down the rest of the way; close the
+	// claw on a game object, hold it and open it
+	unsigned long cycle = t % 9000;
+	liftSet(cycle < 1100 ? 127 : (cycle >= 2500 && cycle < 3000 ? -127 : 0));
+	clawSet(cycle < 600 ? 127 : (cycle < 4600 ? 30 : (cycle < 5100 ? -127 : 0)));
+}
+
+static void _resetMechanisms() {
+	memset(speed, 0, sizeof(speed));
+	memset(position, 0, sizeof(position));
+	pushing = false;
+}
+
+// Runs the demo code under the scripted driver and writes its port log to file
+static bool _record(const char* file) {
+	static unsigned char ring[4096];
+	FILE* out = fopen(file, "wb");
+	if (out == NULL)
+		return false;
+	_resetMechanisms();
+	unsigned int seed = 1;
+	motorManagerLogStart(ring, sizeof(ring));
+	for (unsigned long t = 0; t < MATCH_TIME; t += SLEW_DELTA_T) {
+		_driver(t, &seed);
+		motorManagerStep();
+		for (int ms = 0; ms < SLEW_DELTA_T; ms++)
+			_simulate();
+		motorManagerLogFlush(out);
+	}
+	chassisArcade(0, 0);
+	liftSet(0);
+	clawSet(0);
+	motorManagerStep();
+	motorManagerLogStop();
+	motorManagerLogFlush(out);
+	fclose(out);
+	return true;
+}
+
+// Reads the next record of a port log into the time and the commands of every port. Returns false at the end.
+static bool _nextRecord(FILE* in, unsigned long* time, int* command) {
+	static int value[2 * NUM_MOTORS]; // commands, then outputs
+	unsigned char byte[4];
+	if (fread(byte, 1, 1, in) != 1)
+		return false;
+	if (byte[0] == 255) {
+		if (fread(byte, 1, 4, in) != 4)
+			return false;
+		*time = byte[0] | byte[1] << 8 | byte[2] << 16 | (unsigned long)byte[3] << 24;
+	}
+	else
+		*time += byte[0];
+	if (fread(byte, 1, 3, in) != 3)
+		return false;
+	unsigned long mask = byte[0] | byte[1] << 8 | (unsigned long)byte[2] << 16;
+	if (mask & MTRMGR_LOG_KEY)
+		memset(value, 0, sizeof(value));
+	for (int i = 0; i < 2 * NUM_MOTORS; i++) {
+		if (!(mask & (1UL << i)))
+			continue;
+		if (fread(byte, 1, 1, in) != 1)
+			return false;
+		if (byte[0] != MTRMGR_LOG_ESCAPE)
+			value[i] += (signed char)byte[0];
+		else if (fread(byte, 1, 1, in) == 1)
+			value[i] = (signed char)byte[0];
+		else
+			return false;
+	}
+	memcpy(command, value, NUM_MOTORS * sizeof(int));
+	return true;
+}
+
+// Stops every mechanism, with the thermal model disabled, and gives the ports velocity sources or none
+static void _restart(bool sources) {
+	motorManagerSetThermalLimit(false);
+	chassisSet(0, 0);
+	liftSet(0);
+	clawSet(0);
+	for (int k = 0; k < 1000 / SLEW_DELTA_T; k++)
+		motorManagerStep();
+	for (int m = 0; m < MECHANISMS; m++)
+		blrsMotorSetVelocitySource(ports[m], sources ? velocity[m] : NULL, 127);
+	_resetMechanisms();
+}
+
+/**
+ * @brief Replays a port log through the thermal model and prints what each port went through
+ *
+ * @returns the number of ports limited, or -1 if the log could not be read or a PTC or breaker tripped
+ */
+static int _replay(const char* file, int scenario) {
+	FILE* in = fopen(file, "rb");
+	unsigned char header[5];
+	if (in == NULL || fread(header, 1, 5, in) != 5 || memcmp(header, MTRMGR_LOG_MAGIC, 4) != 0 ||
+	    header[4] != MTRMGR_LOG_VERSION) {
+		printf("%s is not a motor manager port log\n", file);
+		return -1;
+	}
+	_restart(scenario != 1);
+	motorManagerSetThermalLimit(true); // starts cold
+
+	unsigned long time = 0, start = 0, t = 0;
+	unsigned long limited[MECHANISMS] = {0}, firstLimited[MECHANISMS] = {0};
+	int heat[MECHANISMS] = {0}, breaker[MECHANISMS] = {0}, command[NUM_MOTORS];
+	bool more = _nextRecord(in, &time, command), tripped = false;
+	start = time;
+	while (more) {
+		// Send every command recorded up to this update
+		while (more && time - start <= t) {
+			chassisSet(command[CHASSIS_LEFT_MOTOR - 1], command[CHASSIS_RGHT_MOTOR - 1]);
+			liftSet(command[LIFT_MOTOR - 1]);
+			clawSet(command[CLAW_MOTOR - 1]);
+			more = _nextRecord(in, &time, command);
+		}
+		pushing = scenario == 2 && t >= PUSH_START && t < PUSH_END;
+		motorManagerStep();
+		for (int ms = 0; ms < SLEW_DELTA_T; ms++)
+			_simulate();
+		t += SLEW_DELTA_T;
+
+		for (int m = 0; m < MECHANISMS; m++) {
+			MotorThermal state;
+			blrsMotorGetThermal(ports[m], &state);
+			if (state.limited) {
+				if (!limited[m])
+					firstLimited[m] = t;
+				limited[m] += SLEW_DELTA_T;
+			}
+			heat[m] = state.heat > heat[m] ? state.heat : heat[m];
+			breaker[m] = state.breaker > breaker[m] ? state.breaker : breaker[m];
+			tripped = tripped || state.heat >= 100 || state.breaker >= 100;
+		}
+	}
+	fclose(in);
+	motorManagerSetThermalLimit(false);
+
+	int count = 0;
+	for (int m = 0; m < MECHANISMS; m++) {
+		printf("%-19s  %-11s  %4d%%  %6d%%  %7lu", scenarios[scenario], names[m], heat[m], breaker[m], limited[m]);
+		if (limited[m])
+			printf("  %10.2f\n", firstLimited[m] / 1000.0);
+		else
+			printf("  %10s\n", "-");
+		count += limited[m] > 0;
+	}
+	return tripped ? -1 : count;
+}
+
+int main(int argc, char** argv) {
+	const char* file = argc > 1 ? argv[1] : "mtrmgr_thermalreplay.log";
+	chassisInit();
+	liftInit();
+	clawInit();
+	motorManagerInit();
+	if (argc == 1 && !_record(file)) {
+		printf("could not write %s\n", file);
+		return 2;
+	}
+	puts("replay               port         heat  breaker  limited ms  from s");
+	int driving = _replay(file, 0);
+	int assumed = _replay(file, 1);
+	int pushed = argc == 1 ? _replay(file, 2) : 1;
+	bool failed = driving != 0 || pushed <= 0 || assumed < 0;
+	printf("normal driving %s\n", driving == 0 ? "not limited" : "limited or tripped");
+	if (argc == 1)
+		printf("pushing %s\n", pushed > 0 ? "limited without tripping" : "not limited or tripped");
+	return failed ? 1 : 0;
+}